@@ -30,17 +30,11 @@ Write-Host "Please ensure that the DigiKam App is closed before proceeding."
 Write-Host "Would you like me to create a backup of the DigiKam database before synchronization? (Y/N)"
 $response = Read-Host
 
+$syncArgs = @("-r", $rmDbPath, "-d", $dkDbPath)
 if ($response -eq 'Y' -or $response -eq 'y') {
-    $timestamp = Get-Date -Format "yyyyMMdd_HHmmss"
-    $backupPath = "digikam4.db_backup_$timestamp"
-    
-    try {
-        Copy-Item $dkDbPath $backupPath
-        Write-Host "Backup created successfully: $backupPath" -ForegroundColor Green
-    } catch {
-        Write-Error "Failed to create backup: $_"
-        exit 1
-    }
+    # rootsmagic_sync snapshots the database itself (digikam4.db.<timestamp>.bak, last 5 kept)
+    # and skips the copy when nothing changed since the previous backup
+    $syncArgs += "--backup"
 } else {
     Write-Host "Proceeding without backup (not recommended)" -ForegroundColor Yellow
 }
@@ -53,7 +47,7 @@ Write-Host "DigiKam Database:    $dkDbPath"
 Write-Host ""
 
 try {
-    & $syncPath -r $rmDbPath -d $dkDbPath
+    & $syncPath @syncArgs
     
     # Check the exit code
     if ($LASTEXITCODE -ne 0) {
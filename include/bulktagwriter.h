@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include "sqlite3.h"
+#include "statementcache.h"
+#include "tagindex.h"
+
+// Set-based creation of person and family tags. Rows are staged in TEMP tables
+// and each batch is materialized into Tags and the TagProperties rows with a
+// handful of INSERT ... SELECT statements. New tag ids are recovered by joining
+// back on (name, pid), which Tags keeps unique.
+class BulkTagWriter {
+public:
+    BulkTagWriter(sqlite3* db, StatementCache& statements, TagIndex& tagIndex);
+
+    // Creates the staging table; call once per transaction before staging
+    bool begin();
+
+    // Queues a person tag. Returns false if the name is already taken under
+    // that parent, in the database or in the current batch.
+    bool stagePersonTag(int ownerId, int parentTagId, std::string_view name);
+
+    // Queues a family tag, with the same name check as stagePersonTag
+    bool stageFamilyTag(int familyId, int parentTagId, std::string_view name);
+
+    // Writes every staged row and updates the tag index. Family tags go first,
+    // in the order they were staged. Returns false on SQL failure.
+    bool flush();
+
+    int stagedCount() const { return m_stagedCount; }
+
+    // Tag id assigned to an owner or family by the most recent flush, 0 if none
+    int createdTagId(int ownerId) const;
+    int createdFamilyTagId(int familyId) const;
+
+private:
+    bool execute(const char* sql);
+    bool reserveName(int parentTagId, std::string_view name);
+    bool flushFamilies();
+
+    sqlite3* m_db;
+    StatementCache& m_statements;
+    TagIndex& m_tagIndex;
+    int m_stagedCount;
+    int m_stagedFamilyCount;
+    std::unordered_set<std::string> m_stagedKeys;  // "pid/name" of rows in the current batch
+    std::unordered_map<int, int> m_created;
+    std::unordered_map<int, int> m_createdFamilies;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include "sqlite3.h"
+
+// Named sets of SQLite settings for the RootsMagic reader and DigiKam writer
+enum class ConnectionProfile {
+    Safe,  // SQLite defaults, nothing changed
+    Fast,  // Memory-mapped reads, larger caches, in-memory temp tables, synchronous=NORMAL
+    Bulk   // As fast with bigger caches, an immutable RootsMagic read and an unsynced
+           // in-memory journal for the DigiKam transaction
+};
+
+const char* connectionProfileName(ConnectionProfile profile);
+
+// Accepts "safe", "fast" or "bulk"
+bool parseConnectionProfile(std::string_view name, ConnectionProfile& profile);
+
+struct ConnectionSettings {
+    // RootsMagic reader, applied when a read connection is opened
+    bool immutableRead;   // No locking or change detection; RootsMagic must not be writing the file
+    long long mmapSize;   // Bytes of the file to memory-map, 0 for plain reads
+
+    // Both connections
+    int cacheSize;         // PRAGMA cache_size value (negative means KiB), 0 keeps the default
+    bool tempStoreMemory;  // Keep temp tables and sort spills in memory
+
+    // DigiKam writer, only while the sync transaction runs
+    const char* journalMode;  // nullptr keeps the database's own mode
+    const char* synchronous;  // nullptr keeps the default
+
+    static ConnectionSettings forProfile(ConnectionProfile profile);
+};
+
+// Opens a read-only connection with the reader part of the settings applied.
+// Returns the sqlite3_open_v2 result; on failure *db still has to be closed.
+int openReadConnection(const std::string& path, const ConnectionSettings& settings, sqlite3** db);
+
+// Applies the writer part of the settings to a connection for its lifetime and
+// puts the previous values back when destroyed. Must be created and destroyed
+// outside of a transaction, as SQLite won't change the journal mode inside one.
+class ConnectionTuning {
+public:
+    ConnectionTuning(sqlite3* db, const ConnectionSettings& settings);
+    ~ConnectionTuning();
+
+    ConnectionTuning(const ConnectionTuning&) = delete;
+    ConnectionTuning& operator=(const ConnectionTuning&) = delete;
+
+    // Journal mode in effect after the settings were applied, e.g. "delete" or "wal"
+    const std::string& journalMode() const { return m_journalMode; }
+
+private:
+    sqlite3* m_db;
+    std::string m_journalMode;
+    std::string m_previousJournalMode;
+    int m_previousSynchronous;
+    int m_previousCacheSize;
+    int m_previousTempStore;
+    bool m_changedJournalMode;
+    bool m_changedSynchronous;
+    bool m_changedCacheSize;
+    bool m_changedTempStore;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+// Where and how backups of a database are kept. Backups are named
+// "<database file name>.<yyyymmdd_hhmmss>.bak", with ".gz" added when compressed.
+struct BackupOptions {
+    std::string directory;    // Empty: next to the database
+    int keep = 5;             // Newest backups kept; older ones are deleted
+    bool compress = false;    // gzip the backup (needs a build with zlib)
+    int pagesPerStep = 1024;  // Pages copied per sqlite3_backup_step
+};
+
+// Whether this build can write and read compressed backups
+bool backupCompressionAvailable();
+
+// Takes a consistent snapshot of the database through the SQLite online backup
+// API, a slice of pages at a time so other connections are only held up for a
+// step, never for the whole copy. Nothing is copied when neither the database
+// nor its WAL file changed since the newest backup was started. backupPath
+// receives the new backup, or the newest existing one when it was skipped.
+bool backupDatabase(const std::string& databasePath, const BackupOptions& options, std::string& backupPath);
+
+// Replaces the contents of the database with a backup written by backupDatabase
+bool restoreDatabase(const std::string& backupPath, const std::string& databasePath);
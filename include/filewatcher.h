@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Watches a SQLite database file, with its -wal and -journal files, for
+// changes made by other programs. Uses inotify on Linux and change
+// notifications on Windows, both on the file's directory, and polls the file
+// times elsewhere or when neither can be set up. Notifications only wake the
+// watcher; a change is reported when the files' sizes or modification times
+// differ from the ones last seen, so reads and unrelated files never count.
+class FileWatcher {
+public:
+    explicit FileWatcher(const std::string& databasePath,
+                         std::chrono::milliseconds pollInterval = std::chrono::milliseconds(1000));
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Waits up to timeout for a change; true as soon as one is seen
+    bool waitForChange(std::chrono::milliseconds timeout);
+
+    // "inotify", "change notifications" or "polling"
+    const char* mechanism() const;
+
+private:
+    struct FileStamp {
+        long long size;
+        long long modified;
+        bool operator==(const FileStamp& other) const { return size == other.size && modified == other.modified; }
+    };
+
+    std::vector<FileStamp> readStamps() const;
+    bool stampsChanged();
+    // Blocks until a notification arrives or timeout passes
+    void waitForNotification(std::chrono::milliseconds timeout);
+
+    std::vector<std::string> m_paths;
+    std::vector<FileStamp> m_stamps;
+    std::chrono::milliseconds m_pollInterval;
+#ifdef _WIN32
+    void* m_notification;
+#else
+    int m_inotifyFd;
+#endif
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts made by the global operator new/delete replacements in heapstats.cpp.
+// Every allocation pays for them, so that file is only built into
+// rootsmagic_sync with -DRMS_HEAP_STATS=ON, which defines HAVE_HEAP_STATS.
+struct HeapStatistics {
+    size_t allocations;  // Calls to operator new since startup
+    size_t peakBytes;    // Largest number of bytes live at once
+    size_t liveBytes;    // Bytes currently allocated
+};
+
+HeapStatistics heapStatistics();
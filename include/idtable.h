@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Map from RootsMagic or DigiKam ids to values. Those ids are small, dense and
+// mostly increasing, so values live in a vector indexed by id (offset by a base
+// taken from the first insert, so a streamed chunk of high ids stays compact)
+// with an occupancy bitmap, and a lookup is one bounds check plus an array
+// access. If an id would make the vector much larger than the number of entries,
+// or falls below the base, the table moves everything into a hash map and stays there.
+//
+// Pointers returned by find() and operator[] are invalidated by later inserts.
+template <typename T>
+class IdTable {
+public:
+    IdTable() : m_base(0), m_size(0), m_sparse(false) {}
+
+    T* find(int id)
+    {
+        if (m_sparse) {
+            auto it = m_sparseValues.find(id);
+            return it != m_sparseValues.end() ? &it->second : nullptr;
+        }
+        return isOccupied(id) ? &m_values[id - m_base] : nullptr;
+    }
+
+    const T* find(int id) const
+    {
+        if (m_sparse) {
+            auto it = m_sparseValues.find(id);
+            return it != m_sparseValues.end() ? &it->second : nullptr;
+        }
+        return isOccupied(id) ? &m_values[id - m_base] : nullptr;
+    }
+
+    bool contains(int id) const { return find(id) != nullptr; }
+
+    // Returns the value for id, default-constructing it if absent
+    T& operator[](int id)
+    {
+        if (m_size == 0 && !m_sparse) {
+            m_values.clear();
+            m_occupied.clear();
+            m_base = id > kBaseSlack ? id - kBaseSlack : 0;
+        }
+        if (!m_sparse && !fitsDense(id)) {
+            switchToSparse();
+        }
+        if (m_sparse) {
+            auto [it, inserted] = m_sparseValues.try_emplace(id);
+            if (inserted) m_size++;
+            return it->second;
+        }
+
+        size_t index = static_cast<size_t>(id - m_base);
+        if (index >= m_values.size()) {
+            m_values.resize(index + 1);
+            m_occupied.resize(index + 1, false);
+        }
+        if (!m_occupied[index]) {
+            m_occupied[index] = true;
+            m_size++;
+        }
+        return m_values[index];
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    // Capacity hint for a table about to receive count entries
+    void reserve(size_t count)
+    {
+        if (m_sparse) {
+            m_sparseValues.reserve(count);
+        } else {
+            m_values.reserve(count + 1);
+            m_occupied.reserve(count + 1);
+        }
+    }
+
+    void clear()
+    {
+        m_values.clear();
+        m_occupied.clear();
+        m_sparseValues.clear();
+        m_base = 0;
+        m_size = 0;
+        m_sparse = false;
+    }
+
+    // Calls visit(id, value) for every entry; in id order unless the table went sparse
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        if (m_sparse) {
+            for (const auto& [id, value] : m_sparseValues) {
+                visit(id, value);
+            }
+            return;
+        }
+        for (size_t index = 0; index < m_values.size(); index++) {
+            if (m_occupied[index]) {
+                visit(m_base + static_cast<int>(index), m_values[index]);
+            }
+        }
+    }
+
+private:
+    // Ids may run ahead of the entry count by a fixed slack plus a small factor,
+    // and the base leaves a little room for ids just below the first one
+    static constexpr size_t kDenseSlack = 4096;
+    static constexpr size_t kDenseFactor = 4;
+    static constexpr int kBaseSlack = 64;
+
+    bool isOccupied(int id) const
+    {
+        if (id < m_base) return false;
+        size_t index = static_cast<size_t>(id - m_base);
+        return index < m_occupied.size() && m_occupied[index];
+    }
+
+    bool fitsDense(int id) const
+    {
+        if (id < m_base) return false;
+        size_t index = static_cast<size_t>(id - m_base);
+        return index < m_values.size() || index < kDenseSlack + kDenseFactor * (m_size + 1);
+    }
+
+    void switchToSparse()
+    {
+        m_sparseValues.reserve(m_size + 1);
+        for (size_t index = 0; index < m_values.size(); index++) {
+            if (m_occupied[index]) {
+                m_sparseValues.emplace(m_base + static_cast<int>(index), std::move(m_values[index]));
+            }
+        }
+        m_values = std::vector<T>();
+        m_occupied = std::vector<bool>();
+        m_sparse = true;
+    }
+
+    std::vector<T> m_values;
+    std::vector<bool> m_occupied;
+    std::unordered_map<int, T> m_sparseValues;
+    int m_base;  // Id stored at m_values[0]
+    size_t m_size;
+    bool m_sparse;
+};
+
+// Set of ids with the same dense-with-fallback layout
+class IdSet {
+public:
+    // Returns true if id was not already present
+    bool insert(int id)
+    {
+        if (m_ids.contains(id)) return false;
+        m_ids[id] = 1;
+        return true;
+    }
+
+    bool contains(int id) const { return m_ids.contains(id); }
+    size_t size() const { return m_ids.size(); }
+    bool empty() const { return m_ids.empty(); }
+    void reserve(size_t count) { m_ids.reserve(count); }
+    void clear() { m_ids.clear(); }
+
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        m_ids.forEach([&](int id, char) { visit(id); });
+    }
+
+private:
+    IdTable<char> m_ids;  // char rather than bool to stay clear of std::vector<bool>
+};
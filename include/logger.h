@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+enum class LogLevel {
+    Error,
+    Warning,
+    Info,
+    Debug
+};
+
+// Process-wide log output. Info and debug lines are collected in a buffer and
+// written to std::cout in large blocks instead of being flushed line by line;
+// errors and warnings go to std::cerr straight away, after whatever was queued
+// before them so the two streams stay in order. Safe to use from several threads.
+// Programs embedding the sync can take the lines and the progress of long loops
+// themselves through a sink and a progress callback instead.
+class Logger {
+public:
+    // Gets each enabled line without its newline, one call at a time from any thread
+    using Sink = std::function<void(LogLevel level, std::string_view line)>;
+    // Gets the label, items done and items in total of a long loop (see ProgressReporter)
+    using ProgressCallback = std::function<void(std::string_view label, size_t done, size_t total)>;
+
+    static Logger& instance();
+
+    void setLevel(LogLevel level) { m_level = level; }
+    LogLevel level() const { return m_level; }
+    bool isEnabled(LogLevel level) const { return level <= m_level.load(); }
+
+    // Queues whole lines of text at the given level
+    void write(LogLevel level, std::string_view text);
+
+    // Writes everything queued and flushes std::cout
+    void flush();
+
+    // Sends lines to sink instead of the console; an empty sink restores the console
+    void setSink(Sink sink);
+    void setProgressCallback(ProgressCallback callback);
+    void reportProgress(std::string_view label, size_t done, size_t total);
+
+    ~Logger();
+
+private:
+    Logger();
+
+    void writePending();
+
+    static const size_t kBufferSize = 64 * 1024;
+
+    std::atomic<LogLevel> m_level;
+    std::mutex m_mutex;
+    std::string m_pending;
+    Sink m_sink;
+    std::mutex m_progressMutex;
+    ProgressCallback m_progressCallback;
+};
+
+// Streams for each level, one set per thread. Text reaches the logger a line at
+// a time, so lines from different threads never interleave. While a level is
+// disabled its stream is in a failed state and << does no formatting at all.
+// std::endl only ends the line here; it does not flush the console.
+std::ostream& logError();
+std::ostream& logWarning();
+std::ostream& logInfo();
+std::ostream& logDebug();
+
+// Progress of a long loop, reported at most once per interval rather than on
+// every percent, plus a final line when the loop completes. Each report also
+// goes to the logger's progress callback, even while the log level hides it.
+class ProgressReporter {
+public:
+    ProgressReporter(std::ostream& log, const char* label, const char* unit, size_t total,
+                     std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
+    void advance(size_t count = 1);
+
+private:
+    void report();
+
+    std::ostream& m_log;
+    const char* m_label;
+    const char* m_unit;
+    size_t m_total;
+    size_t m_done;
+    std::chrono::milliseconds m_interval;
+    std::chrono::steady_clock::time_point m_lastReport;
+};
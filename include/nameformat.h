@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct PersonRecord;
+struct FamilyRecord;
+
+// Tag name layout, parsed once from a template such as
+// "{given} {surname} {birth}-{death} (OwnerID: {id})" into a list of literal
+// runs and fields. Rendering appends to a caller-owned buffer and writes numbers
+// with std::to_chars, so it does not allocate once the buffer has grown.
+//
+// Person fields: {given} {surname} {birth} {death} {id}
+// Family fields: {father} {mother} {id} {father_given} {father_surname} {father_id}
+//                {mother_given} {mother_surname} {mother_id}
+// Years of 0 render as "unknown"; {father} and {mother} render as
+// "Given Surname (OwnerID: N)" or "unknown". Use {{ and }} for literal braces.
+class NameFormat {
+public:
+    static const char* const kDefaultPersonFormat;
+    static const char* const kDefaultFamilyFormat;
+
+    // Parse a template; on failure the format is left unchanged and error says why
+    bool parsePerson(std::string_view text, std::string& error);
+    bool parseFamily(std::string_view text, std::string& error);
+
+    void render(const PersonRecord& person, std::string& out) const;
+    void render(const FamilyRecord& family, std::string& out) const;
+
+    // True if the template includes {id}, which keeps names unique under a parent
+    bool includesId() const;
+
+    const std::string& text() const { return m_text; }
+
+private:
+    enum class Field : uint8_t {
+        Literal,
+        Given, Surname, BirthYear, DeathYear, OwnerId,
+        Father, Mother, FamilyId,
+        FatherGiven, FatherSurname, FatherId,
+        MotherGiven, MotherSurname, MotherId
+    };
+
+    struct FieldName {
+        const char* name;
+        Field field;
+    };
+
+    struct Instruction {
+        Field field;
+        uint32_t offset;  // Literal runs only: position in m_literals
+        uint32_t length;
+    };
+
+    bool parse(std::string_view text, const FieldName* fields, size_t fieldCount, std::string& error);
+
+    std::string m_text;
+    std::string m_literals;
+    std::vector<Instruction> m_instructions;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// Case-insensitive comparison standing in for RootsMagic's proprietary RMNOCASE
+// collation, which RootsMagic puts on its name columns and indexes. Compares in
+// place without allocating: runs of ASCII are folded eight bytes at a time, and
+// anything else is decoded as UTF-8 and compared by simple case-folded code point,
+// so "ÅNGSTRÖM" and "ångström" compare equal. Malformed UTF-8 bytes compare as
+// their byte value. Returns <0, 0 or >0 like memcmp.
+int rmnocaseCompare(const char* left, int leftLength, const char* right, int rightLength);
+
+// Registers rmnocaseCompare as the RMNOCASE collation; returns an SQLite result code
+int registerRmnocaseCollation(sqlite3* db);
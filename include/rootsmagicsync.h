@@ -1,17 +1,30 @@
 #pragma once
 
+#include <memory>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
-#include <unordered_map>
 #include "sqlite3.h"
+#include "connectionprofile.h"
+#include "logger.h"
+#include "idtable.h"
+#include "nameformat.h"
+#include "statementcache.h"
+#include "stringarena.h"
+#include "syncmetrics.h"
+#include "tagindex.h"
 
+// Text fields of the records below are views into RootsMagicSync's string arena
+// and are only valid during the sync run that loaded them.
 struct PersonRecord {
     int ownerId;
-    std::string surname;
-    std::string given;
+    std::string_view surname;
+    std::string_view given;
     int birthYear;
     int deathYear;
-    std::string formattedName;
+    std::string_view formattedName;
     int familyId;  // New field to track family ID
 };
 
@@ -19,20 +32,84 @@ struct FamilyRecord {
     int familyId;
     int fatherOwnerId;
     int motherOwnerId;
-    std::string fatherGiven;
-    std::string fatherSurname;
-    std::string motherGiven;
-    std::string motherSurname;
-    std::string familyTagName;
+    std::string_view fatherGiven;
+    std::string_view fatherSurname;
+    std::string_view motherGiven;
+    std::string_view motherSurname;
+    std::string_view familyTagName;
 };
 
 struct DigiKamTag {
     int tagId;
-    std::string name;
+    int parentId;
+    std::string_view name;
     int ownerId;
     bool isOrphaned;
 };
 
+struct SyncPlan;
+
+// One RootsMagic file and the DigiKam tag its people are kept under
+struct SyncJob {
+    std::string rootsMagicPath;
+    std::string parentTagName = "RootsMagic";
+};
+
+// Outcome of one tree in the last synchronizeTags or synchronizeBatch call
+struct SyncTreeResult {
+    SyncTreeResult() = default;
+    SyncTreeResult(std::string path, std::string parentTag)
+        : rootsMagicPath(std::move(path)), parentTagName(std::move(parentTag)) {}
+
+    std::string rootsMagicPath;
+    std::string parentTagName;
+    bool success = false;
+    size_t people = 0;
+    int tagsCreated = 0;
+    int tagsUpdated = 0;
+    int tagsOrphaned = 0;
+    int tagsRescued = 0;
+    int familyTagsRenamed = 0;
+    int familyTagsCollapsed = 0;  // Stale duplicates of a family's tag merged into it
+    size_t rootsMagicTags = 0;  // Owners under the parent tag afterwards
+    size_t lostFoundTags = 0;   // Owners under Lost & Found afterwards
+
+    // RootsMagic owner ids behind the counts above, in ascending order
+    std::vector<int> createdOwnerIds;
+    std::vector<int> renamedOwnerIds;
+    std::vector<int> orphanedOwnerIds;
+    std::vector<int> rescuedOwnerIds;
+};
+
+// Everything a program embedding the sync needs to know about the last run,
+// without reading its log
+struct SyncReport {
+    struct Phase {
+        const char* name;  // syncPhaseName(), e.g. "person_sync"
+        double milliseconds;
+        long long rows;
+    };
+
+    bool success = false;
+    std::string mode;  // "full", "incremental" or "streaming"
+    double totalMilliseconds = 0;
+    std::vector<Phase> phases;  // Every phase in run order, zero for phases that did not run
+    long long statementsExecuted = 0;
+    long long rowsWritten = 0;
+
+    // Totals over the trees that succeeded
+    size_t people = 0;
+    int tagsCreated = 0;
+    int tagsUpdated = 0;
+    int tagsOrphaned = 0;
+    int tagsRescued = 0;
+    int familyTagsRenamed = 0;
+    int familyTagsCollapsed = 0;
+
+    // One entry per RootsMagic file, with the owner ids that changed in it
+    std::vector<SyncTreeResult> trees;
+};
+
 class RootsMagicSync {
 public:
     RootsMagicSync();
@@ -42,43 +119,202 @@ public:
     bool connectToRootsMagicDatabase(const std::string& rmDbPath);
     bool connectToDigiKamDatabase(const std::string& dkDbPath);
 
-    // Main synchronization function
+    // Create new person tags in set-based batches of batchSize instead of one at a time
+    void setBulkApply(bool enabled, int batchSize = 1000);
+
+    // Only load people and families modified since the last recorded sync
+    void setIncremental(bool enabled);
+
+    // Load RootsMagic people, families and DigiKam tags on parallel read connections (default on)
+    void setConcurrentLoad(bool enabled);
+
+    // Walk NameTable in OwnerID order and plan and apply one chunk at a time, sizing
+    // chunks so RootsMagic rows and per-chunk work stay within memoryLimitMb.
+    // The DigiKam tag index used for name checks is not covered by the limit.
+    void setStreaming(bool enabled, size_t memoryLimitMb = 64);
+
+    // SQLite settings for both connections (see connectionprofile.h; default safe).
+    // Reader settings take effect for connections opened after this call.
+    void setConnectionProfile(ConnectionProfile profile);
+
+    // Create TagProperties' owner and family id index if missing (see TagIndex::createLookupIndex)
+    void setOwnerIndex(bool enabled);
+
+    // Tag name templates for people and family tags (see nameformat.h for the fields).
+    // Returns false and leaves the current formats in place if either does not parse.
+    bool setNameFormats(const std::string& personFormat, const std::string& familyFormat);
+
+    // Where log lines and loop progress go instead of the console (see Logger).
+    // The log is process-wide, so these apply to every instance.
+    static void setLogCallback(Logger::Sink sink);
+    static void setProgressCallback(Logger::ProgressCallback callback);
+
+    // Main synchronization function. Can be called again and again on the same
+    // connections; the tag index and prepared statements are kept between calls.
     bool synchronizeTags(const std::string& parentTagName = "RootsMagic", 
                         const std::string& lostFoundTagName = "Lost & Found");
 
+    // Syncs several RootsMagic files into the connected DigiKam database in one
+    // transaction, sharing the DigiKam tag index between them. Each tree runs in
+    // its own savepoint: a tree that fails is rolled back alone and the others
+    // are still committed. Returns false if any tree failed. Connects to each
+    // RootsMagic file in turn, so no RootsMagic connection is needed beforehand.
+    bool synchronizeBatch(const std::vector<SyncJob>& jobs,
+                          const std::string& lostFoundTagName = "Lost & Found");
+
+    // synchronizeTags that hands back the report rather than a bool
+    SyncReport synchronize(const std::string& parentTagName = "RootsMagic",
+                           const std::string& lostFoundTagName = "Lost & Found");
+
+    // Whether another program holds a lock on the DigiKam database that would stop a sync
+    bool isDigiKamLocked();
+
+    // Outcome of the last synchronizeTags or synchronizeBatch call
+    const SyncReport& report() const { return m_report; }
+
+    // Per-statement usage of the prepared statement caches (both connections)
+    std::vector<StatementCache::Statistics> statementStatistics() const;
+
+    // Bytes of record text held by the last sync run
+    size_t stringBytesStored() const { return m_strings.bytesStored(); }
+
+    // Phase timings and counters of the last sync run; writable so callers can
+    // add what they measure around it, like the change latency in watch mode
+    const SyncMetrics& metrics() const { return m_metrics; }
+    SyncMetrics& metrics() { return m_metrics; }
+
 private:
+    // Syncs one tree; nested runs it in a savepoint of an already open transaction
+    bool runSynchronization(const std::string& parentTagName, const std::string& lostFoundTagName,
+                            SyncTreeResult& result, bool nested);
+    void closeRootsMagicDatabase();
+    void finishReport(bool success);
+    long long digiKamDataVersion();
+    void dropStaleTagIndex();
+
     // Data loading functions
-    std::vector<PersonRecord> loadRootsMagicPeople();
-    std::unordered_map<int, FamilyRecord> loadFamilyData();
-    std::unordered_map<int, DigiKamTag> loadExistingDigiKamTags(const std::string& parentTagName);
+    std::vector<PersonRecord> loadRootsMagicPeople(sqlite3* db, StatementCache& statements,
+                                                   StringArena& strings, std::ostream& log);
+    IdTable<FamilyRecord> loadFamilyData(sqlite3* db, StatementCache& statements,
+                                                         StringArena& strings, std::ostream& log);
+    IdTable<DigiKamTag> ownerTagsUnder(int rootTagId, StringArena& strings) const;
+    bool loadDigiKamTrees(const std::string& parentTagName, const std::string& lostFoundTagName,
+                          IdTable<DigiKamTag>& existingTags,
+                          IdTable<DigiKamTag>& lostFoundTags,
+                          StringArena& strings, std::ostream& log);
+    void ensureOwnerIndex();
+    bool canLoadConcurrently() const;
+    bool loadConcurrently(const std::string& parentTagName, const std::string& lostFoundTagName,
+                          std::vector<PersonRecord>& people,
+                          IdTable<FamilyRecord>& families,
+                          IdTable<DigiKamTag>& existingTags,
+                          IdTable<DigiKamTag>& lostFoundTags);
+    PersonRecord readPersonRow(sqlite3_stmt* stmt, StringArena& strings);
+    FamilyRecord readFamilyRow(sqlite3_stmt* stmt, StringArena& strings);
+
+    // Incremental sync support
+    bool hasModificationDates();
+    double loadRootsMagicChangeMark();
+    double readSyncMark(const std::string& parentTagName, int& parentTagId);
+    bool writeSyncMark(int parentTagId, double mark);
+    IdSet loadRootsMagicOwnerIds();
+    bool loadChangedRootsMagicData(double changedSince, int parentTagId,
+                                   const IdTable<DigiKamTag>& existingTags,
+                                   const IdTable<DigiKamTag>& lostFoundTags,
+                                   std::vector<PersonRecord>& people,
+                                   IdTable<FamilyRecord>& families,
+                                   IdSet& liveOwnerIds);
+    bool loadFamiliesForPeople(const std::vector<PersonRecord>& people,
+                               IdTable<FamilyRecord>& families);
+    bool loadChangedFamilies(double changedSince, IdTable<FamilyRecord>& families);
+
+    // Prefixes query with a CTE "subtree(id)" of every descendant of the tag named by parameter 1
+    std::string tagSubtreeSql(const char* query) const;
+
+    // Streaming sync support
+    // Owner tags under the tag named by parameter 1, as copied into the snapshot; parameter 2 is the tree
+    static const char* const kSnapshotSql;
+    size_t streamSynchronize(const std::string& parentTagName, const std::string& lostFoundTagName,
+                             int parentTagId, int lostFoundTagId);
+    bool snapshotDigiKamTags(const std::string& parentTagName, const std::string& lostFoundTagName);
+    bool loadSnapshotRange(int tree, int lowerOwnerId, int upperOwnerId,
+                           IdTable<DigiKamTag>& tags);
+    bool loadRootsMagicChunk(int afterOwnerId, size_t limit, std::vector<PersonRecord>& people);
 
     // Sync operations
-    bool ensureParentTagExists(const std::string& tagName);
-    bool createFamilyTag(const FamilyRecord& family, const std::string& parentTagName);
-    bool createPersonTag(const PersonRecord& person, const std::string& parentTagName, 
-                        const std::unordered_map<int, FamilyRecord>& families);
+    void applySyncPlan(const SyncPlan& plan, int parentTagId, int lostFoundTagId);
+    bool ensureParentTagExists(const std::string& tagName, int& tagId);
+    IdTable<int> materializeFamilyTags(const std::vector<const FamilyRecord*>& families,
+                                       const std::vector<const FamilyRecord*>& refreshOnly, int parentTagId);
+    bool renameFamilyTags(const std::vector<std::pair<int, std::string_view>>& renames);
+    bool collapseFamilyTags(const std::vector<std::pair<int, int>>& merges);
+    bool createPersonTag(const PersonRecord& person, int parentTagId);
     bool updatePersonTag(int tagId, const PersonRecord& person);
-    bool moveOrphanedTagsToLostFound(const std::vector<int>& orphanedTagIds, 
-                                    const std::string& lostFoundTagName,
-                                    const std::unordered_map<int, DigiKamTag>& existingTags);
-    bool rescueTagFromLostFound(const PersonRecord& person, const std::string& parentTagName,
-                               const std::unordered_map<int, DigiKamTag>& lostFoundTags);
+    bool moveTag(int tagId, int newParentTagId);
+    // Moves each (tag, new parent) pair with one UPDATE ... FROM a staged TEMP table
+    bool moveTags(const std::vector<std::pair<int, int>>& moves);
+    bool hasTreeParentIndex();
+    // Orphans whose name Lost & Found already holds are left where they are
+    bool moveOrphanedTagsToLostFound(const std::vector<const DigiKamTag*>& orphanedTags, 
+                                    int lostFoundTagId);
+    bool rescueTagFromLostFound(const DigiKamTag& lostTag, const PersonRecord& person, int parentTagId);
 
     bool removeDuplicateTags(const std::vector<int>& tagIds);
 
     // Utility functions
-    std::string formatPersonName(const PersonRecord& person);
-    std::string formatFamilyTagName(const FamilyRecord& family);
+    static sqlite3* openRootsMagicReader(const std::string& rmDbPath, const ConnectionSettings& settings);
+    std::string_view formatPersonName(const PersonRecord& person, StringArena& strings);
+    std::string_view formatFamilyTagName(const FamilyRecord& family, StringArena& strings);
+    static std::string_view columnView(sqlite3_stmt* stmt, int column);
     std::string escapeSqlString(const std::string& str);
     bool executeQuery(sqlite3* db, const std::string& query);
+
+    // Fewest moves for which moveTags builds a temporary TagsTree (pid) index;
+    // building one costs about as much as a few moves without it
+    static const size_t kTreeIndexMinMoves = 16;
     
     // Database connections
     sqlite3* m_rootsMagicDb;
     sqlite3* m_digiKamDb;
+    std::string m_rootsMagicPath;
+    bool m_hasTagsTree;
+
+    // Prepared statements, one cache per connection
+    std::unique_ptr<StatementCache> m_rootsMagicStatements;
+    std::unique_ptr<StatementCache> m_digiKamStatements;
+
+    // DigiKam tag tree, kept in step with every write made during a sync and
+    // reused by the next one while no other program has written to DigiKam
+    TagIndex m_tagIndex;
+    long long m_tagIndexVersion;  // PRAGMA data_version when m_tagIndex was last current
+
+    // Text of every record loaded by the current run
+    StringArena m_strings;
+
+    // Instrumentation of the current run; attached to every connection
+    SyncMetrics m_metrics;
+
+    // Tag name layouts
+    NameFormat m_personFormat;
+    NameFormat m_familyFormat;
+
+    // Apply options
+    bool m_bulkApply;
+    int m_batchSize;
+    bool m_incremental;
+    bool m_concurrentLoad;
+    bool m_streaming;
+    size_t m_streamChunkSize;
+    ConnectionProfile m_connectionProfile;
+    ConnectionSettings m_connectionSettings;
+    bool m_ownerIndex;
     
-    // Statistics
-    int m_tagsCreated;
-    int m_tagsUpdated;
-    int m_tagsOrphaned;
-    int m_tagsRescued;
+    // Statistics; the owner id lists collect the changes of the tree being synced
+    SyncReport m_report;
+    std::vector<int> m_createdOwnerIds;
+    std::vector<int> m_renamedOwnerIds;
+    std::vector<int> m_orphanedOwnerIds;
+    std::vector<int> m_rescuedOwnerIds;
+    int m_familyTagsRenamed;
+    int m_familyTagsCollapsed;
 };
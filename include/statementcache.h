@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "sqlite3.h"
+
+// Registry of prepared statements for a single connection. Each distinct SQL
+// text is compiled once; later requests get the same handle back, reset and
+// with its bindings cleared.
+class StatementCache {
+public:
+    struct Statistics {
+        std::string sql;
+        int hits;  // Number of times the statement was handed out
+    };
+
+    explicit StatementCache(sqlite3* db);
+    ~StatementCache();
+
+    StatementCache(const StatementCache&) = delete;
+    StatementCache& operator=(const StatementCache&) = delete;
+
+    // Returns a statement ready for binding, or nullptr if the SQL does not compile
+    sqlite3_stmt* acquire(std::string_view sql);
+
+    // Finalizes every cached statement; must run before the connection is closed
+    void clear();
+
+    std::vector<Statistics> statistics() const;
+    int preparedCount() const { return static_cast<int>(m_statements.size()); }
+    int totalHits() const;
+
+private:
+    struct Entry {
+        std::string sql;
+        sqlite3_stmt* stmt;
+        int hits;
+    };
+
+    sqlite3* m_db;
+    // Keys view into Entry::sql, which stays put because entries are heap allocated
+    std::unordered_map<std::string_view, std::unique_ptr<Entry>> m_statements;
+};
+
+// Scoped use of a cached statement. The statement is reset when the handle goes
+// out of scope so no cursor is left open on the connection between calls.
+class CachedStatement {
+public:
+    CachedStatement(StatementCache& cache, std::string_view sql)
+        : m_stmt(cache.acquire(sql)) {}
+    ~CachedStatement() {
+        if (m_stmt) {
+            sqlite3_reset(m_stmt);
+        }
+    }
+
+    CachedStatement(const CachedStatement&) = delete;
+    CachedStatement& operator=(const CachedStatement&) = delete;
+
+    explicit operator bool() const { return m_stmt != nullptr; }
+    operator sqlite3_stmt*() const { return m_stmt; }
+
+private:
+    sqlite3_stmt* m_stmt;
+};
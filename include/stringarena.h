@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Bump allocator for the text read during a sync run. Strings are copied in
+// once and handed back as views; nothing is freed individually, and every view
+// stays valid until clear() or the arena is destroyed.
+class StringArena {
+public:
+    explicit StringArena(size_t blockSize = 64 * 1024);
+
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+    StringArena(StringArena&&) = default;
+    StringArena& operator=(StringArena&&) = default;
+
+    // Copies text into the arena and returns a view of the copy
+    std::string_view store(std::string_view text);
+
+    // Takes over another arena's blocks so views into it outlive that arena
+    void absorb(StringArena&& other);
+
+    // Releases every block; all views handed out become dangling
+    void clear();
+
+    size_t bytesStored() const { return m_bytesStored; }
+    size_t blockCount() const { return m_blocks.size(); }
+
+private:
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    size_t m_blockSize;
+    char* m_cursor;
+    size_t m_remaining;
+    size_t m_bytesStored;
+};
+
+// Drops trailing spaces and tabs without copying
+inline std::string_view trimTrailingWhitespace(std::string_view text)
+{
+    size_t end = text.find_last_not_of(" \t");
+    return end == std::string_view::npos ? std::string_view() : text.substr(0, end + 1);
+}
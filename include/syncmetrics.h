@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sqlite3.h"
+
+// Stages of a sync run that are timed separately. Streaming runs add up each
+// chunk's time in the same phases.
+enum class SyncPhase {
+    RootsMagicLoad,
+    FamilyLoad,
+    DigiKamLoad,
+    Planning,
+    DuplicateCleanup,
+    FamilyTags,
+    FamilyParenting,
+    PersonSync,
+    PostRescueCleanup,
+    OrphanMove,
+    Commit,
+    Count
+};
+
+// Name used for a phase in the metrics report, e.g. "rootsmagic_load"
+const char* syncPhaseName(SyncPhase phase);
+
+// Instrumentation for one sync run: wall time and rows per phase, SQL statements
+// executed on the attached connections (counted with sqlite3_trace_v2, trigger
+// bodies excluded), rows written to DigiKam's Tags, TagProperties and ImageTags
+// tables (counted with sqlite3_update_hook, so TEMP tables and the TagsTree rows
+// DigiKam's triggers maintain are left out), bytes read from the database files
+// (page cache misses times page size) and the process's peak resident set size.
+// Different phases may be recorded from different threads at the same time.
+class SyncMetrics {
+public:
+    struct Phase {
+        double milliseconds;
+        long long rows;  // Rows loaded for load phases, rows written for the others
+    };
+
+    SyncMetrics();
+
+    SyncMetrics(const SyncMetrics&) = delete;
+    SyncMetrics& operator=(const SyncMetrics&) = delete;
+
+    // Clears everything recorded and starts the run clock
+    void start();
+
+    // Stops the run clock, collects the remaining reads and samples peak memory
+    void finish(bool success);
+
+    void addPhase(SyncPhase phase, double milliseconds, long long rows);
+
+    // Starts counting statements, reads and written rows on db; detach it before closing it
+    void attach(sqlite3* db);
+    // Adds what db has read since the last collection and stops tracing it
+    void detach(sqlite3* db);
+
+    void setMode(const std::string& mode, bool bulkApply);
+    void setConnectionProfile(const std::string& profile, const std::string& journalMode);
+    void setPeople(long long people) { m_people = people; }
+    void setTagCounts(int created, int updated, int orphaned, int rescued);
+    // Time from a RootsMagic change being noticed to the end of the resync (watch mode)
+    void setChangeLatency(double milliseconds) { m_changeLatencyMilliseconds = milliseconds; }
+
+    const Phase& phase(SyncPhase phase) const { return m_phases[static_cast<size_t>(phase)]; }
+    long long statementsExecuted() const { return m_statementsExecuted.load(); }
+    long long bytesRead() const { return m_bytesRead.load(); }
+    long long rowsWritten() const { return m_rowsWritten.load(); }
+    size_t peakResidentBytes() const { return m_peakResidentBytes; }
+    double totalMilliseconds() const { return m_totalMilliseconds; }
+    const std::string& mode() const { return m_mode; }
+    double changeLatencyMilliseconds() const { return m_changeLatencyMilliseconds; }  // Negative if not set
+
+    // Writes the report as a JSON object; returns false if the file can't be written
+    bool writeJson(const std::string& path) const;
+
+private:
+    static int traceStatement(unsigned type, void* context, void* statement, void* sql);
+    static void countRowWritten(void* context, int operation, const char* database, const char* table,
+                                sqlite3_int64 rowId);
+    void collectReads(sqlite3* db, int pageSize);
+
+    std::array<Phase, static_cast<size_t>(SyncPhase::Count)> m_phases;
+    std::atomic<long long> m_statementsExecuted;
+    std::atomic<long long> m_bytesRead;
+    std::atomic<long long> m_rowsWritten;
+
+    // Page size of every attached connection, needed to turn cache misses into bytes
+    std::mutex m_connectionsMutex;
+    std::vector<std::pair<sqlite3*, int>> m_connections;
+
+    std::chrono::system_clock::time_point m_startedAt;
+    std::chrono::steady_clock::time_point m_startClock;
+    double m_totalMilliseconds;
+    bool m_success;
+    std::string m_mode;
+    bool m_bulkApply;
+    std::string m_connectionProfile;
+    std::string m_journalMode;
+    long long m_people;
+    int m_tagsCreated;
+    int m_tagsUpdated;
+    int m_tagsOrphaned;
+    int m_tagsRescued;
+    size_t m_peakResidentBytes;
+    double m_changeLatencyMilliseconds;
+};
+
+// Times a phase from construction to destruction. Rows are either set by the
+// caller or, with countWrites, the DigiKam rows written in the meantime.
+class PhaseTimer {
+public:
+    PhaseTimer(SyncMetrics& metrics, SyncPhase phase, bool countWrites = false);
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    void setRows(long long rows) { m_rows = rows; }
+    // Time since construction
+    double elapsedMilliseconds() const;
+
+private:
+    SyncMetrics& m_metrics;
+    SyncPhase m_phase;
+    bool m_countWrites;
+    long long m_rowsWrittenAtStart;
+    long long m_rows;
+    std::chrono::steady_clock::time_point m_start;
+};
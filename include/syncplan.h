@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "idtable.h"
+#include "rootsmagicsync.h"
+
+struct PlannedRename {
+    const DigiKamTag* tag;
+    const PersonRecord* person;
+};
+
+struct PlannedReparent {
+    const DigiKamTag* tag;
+    const PersonRecord* person;
+    const FamilyRecord* family;
+};
+
+struct PlannedRescue {
+    const DigiKamTag* tag;  // The person's tag in Lost & Found
+    const PersonRecord* person;
+};
+
+// Everything a sync run will change, computed up front from the loaded records.
+// Entries point into the inputs given to buildSyncPlan, which must outlive the plan.
+struct SyncPlan {
+    std::vector<const DigiKamTag*> duplicateDeletes;   // Lost & Found copies of tags still in the main tree
+    std::vector<const FamilyRecord*> familyTags;       // Families referenced by at least one person
+    std::vector<const FamilyRecord*> familyRefreshes;  // Other loaded families; existing tags are renamed, none created
+    std::vector<PlannedReparent> reparents;            // Existing tags of people in a family, checked against the family tag
+    std::vector<PlannedRename> renames;
+    std::vector<const PersonRecord*> creates;
+    std::vector<PlannedRescue> rescues;
+    std::vector<const DigiKamTag*> orphanMoves;        // Tags whose person is gone from RootsMagic
+
+    size_t changeCount() const {
+        return duplicateDeletes.size() + renames.size() +
+               creates.size() + rescues.size() + orphanMoves.size();
+    }
+};
+
+// Diffs RootsMagic against the two DigiKam subtrees in linear time. Touches no database.
+// When people holds only changed records, liveOwnerIds must list every person still in
+// RootsMagic so unchanged people are not mistaken for orphans.
+SyncPlan buildSyncPlan(const std::vector<PersonRecord>& people,
+                       const IdTable<FamilyRecord>& families,
+                       const IdTable<DigiKamTag>& existingTags,
+                       const IdTable<DigiKamTag>& lostFoundTags,
+                       const IdSet* liveOwnerIds = nullptr);
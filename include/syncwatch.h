@@ -0,0 +1,20 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include "rootsmagicsync.h"
+
+struct WatchOptions {
+    std::chrono::milliseconds debounce{2000};     // Quiet time after the last write before resyncing
+    std::chrono::milliseconds maxDelay{30000};    // Resync at the latest this long after the first write
+    std::chrono::milliseconds maxBackoff{60000};  // Longest wait between attempts while DigiKam is locked
+    std::string metricsPath;                      // Rewritten after every resync when set
+};
+
+// Syncs once, then keeps sync and its connections alive and resyncs whenever
+// the RootsMagic file changes, until Ctrl+C (SIGINT) or SIGTERM. sync must be
+// connected to both databases; it keeps its tag index and prepared statements
+// between resyncs. Returns false only if the first sync fails.
+bool watchAndSynchronize(RootsMagicSync& sync, const std::string& rootsMagicPath,
+                         const std::string& parentTagName, const std::string& lostFoundTagName,
+                         const WatchOptions& options);
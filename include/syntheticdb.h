@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Shape of a generated RootsMagic file. People are created household by
+// household: two parents (one of them missing in a few families) and a handful
+// of children who take the father's surname. Children later become parents of
+// their own, so the result is a connected multi-generation tree. Names follow a
+// skewed frequency distribution and include Scandinavian and German spellings.
+struct SyntheticTreeOptions {
+    size_t people = 10000;
+    unsigned seed = 1;
+    double alternateNameRate = 0.1;  // Share of people with an extra non-primary name
+    double modificationDate = 2460000.0;  // UTCModDate written on every row (Julian day)
+};
+
+// Pre-existing state of a generated DigiKam database. Person tags are created
+// directly under the parent tag, as older versions of the sync left them, with
+// the default "Given Surname Birth-Death (OwnerID: N)" names.
+struct SyntheticTagOptions {
+    std::string parentTagName = "RootsMagic";
+    std::string lostFoundTagName = "Lost & Found";
+    double taggedFraction = 0.0;     // Share of RootsMagic people already tagged
+    double lostFoundFraction = 0.0;  // Share of people whose tag sits in Lost & Found
+    double staleNameFraction = 0.0;  // Share of existing tags with an outdated name
+    size_t orphanTags = 0;           // Extra tags for OwnerIDs RootsMagic does not have
+    unsigned seed = 1;
+};
+
+// Writes a new RootsMagic database (NameTable, PersonTable, FamilyTable,
+// ChildTable) at path, replacing any existing file
+bool generateRootsMagicDatabase(const std::string& path, const SyntheticTreeOptions& options);
+
+// Writes a new DigiKam database at path with the Tags, TagsTree, TagProperties
+// and ImageTags tables and DigiKam's tree triggers, plus some unrelated tags.
+// People for the pre-existing tags are read from the RootsMagic file at rootsMagicPath.
+bool generateDigiKamDatabase(const std::string& path, const std::string& rootsMagicPath,
+                             const SyntheticTagOptions& options);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "sqlite3.h"
+#include "statementcache.h"
+
+struct TagIndexEntry {
+    int id;
+    int pid;
+    std::string name;
+    int ownerId;   // rootsmagic_owner_id property, 0 if absent
+    int familyId;  // family_id property, 0 if absent
+};
+
+// In-memory copy of the DigiKam Tags table plus the RootsMagic properties.
+// Loaded once per run and kept current by the sync as it writes, so parent
+// lookups and existence checks never have to go back to the database.
+class TagIndex {
+public:
+    TagIndex();
+
+    // Child maps hold views of the entries' names, which a copy would not own
+    TagIndex(const TagIndex&) = delete;
+    TagIndex& operator=(const TagIndex&) = delete;
+
+    bool load(sqlite3* db, StatementCache& statements);
+
+    // Opt-in partial index over the owner and family id rows of TagProperties,
+    // keyed by (property, integer value), so loading those rows is an index
+    // search instead of a scan of every tag property DigiKam holds. Being
+    // partial, it is never picked over the tagid index for other properties.
+    // Once created, SQLite keeps it current for DigiKam's own writes as well as ours.
+    static const char* const kLookupIndexName;
+    // The property load the index is built for
+    static const char* const kPropertiesSql;
+    static bool createLookupIndex(sqlite3* db);
+    // Asks EXPLAIN QUERY PLAN whether sql actually searches the index
+    static bool lookupIndexUsed(sqlite3* db, const std::string& sql);
+    void clear();
+    bool isLoaded() const { return m_loaded; }
+    size_t size() const { return m_tags.size(); }
+
+    // Lookups; tag ids are 0 when nothing matches
+    const TagIndexEntry* findById(int tagId) const;
+    int findChild(int pid, std::string_view name) const;
+    int findByName(std::string_view name) const;
+    int findOwnerTag(int ownerId, int pid) const;
+    const std::vector<int>& tagsForOwner(int ownerId) const;
+    const std::vector<int>& tagsForFamily(int familyId) const;
+    std::vector<int> childrenOf(int tagId) const;
+
+    // Distinct owner ids among all descendants of a tag
+    size_t countOwnersUnder(int tagId) const;
+
+    // Calls visit(const TagIndexEntry&) for every descendant of a tag, in no particular order
+    template <typename Visitor>
+    void forEachDescendant(int tagId, Visitor visit) const
+    {
+        std::vector<int> pending{tagId};
+        while (!pending.empty()) {
+            auto childrenIt = m_children.find(pending.back());
+            pending.pop_back();
+            if (childrenIt == m_children.end()) continue;
+
+            for (const auto& [name, childId] : childrenIt->second) {
+                visit(m_tags.at(childId));
+                pending.push_back(childId);
+            }
+        }
+    }
+
+    // Mirror writes made to the database
+    void addTag(int tagId, int pid, std::string_view name);
+    void renameTag(int tagId, std::string_view name);
+    void moveTag(int tagId, int newPid);
+    void removeTag(int tagId);
+    void setOwnerId(int tagId, int ownerId);
+    void setFamilyId(int tagId, int familyId);
+
+private:
+    void linkToParent(const TagIndexEntry& entry);
+    void unlinkFromParent(const TagIndexEntry& entry);
+    static void eraseId(std::unordered_map<int, std::vector<int>>& map, int key, int tagId);
+
+    bool m_loaded;
+    std::unordered_map<int, TagIndexEntry> m_tags;
+    // pid -> name -> id; each name views the string in its own entry in m_tags,
+    // whose nodes never move, so lookups by string_view need no copy
+    std::unordered_map<int, std::unordered_map<std::string_view, int>> m_children;
+    std::unordered_map<int, std::vector<int>> m_byOwner;
+    std::unordered_map<int, std::vector<int>> m_byFamily;
+};
@@ -0,0 +1,212 @@
+#include "bulktagwriter.h"
+#include "logger.h"
+
+BulkTagWriter::BulkTagWriter(sqlite3* db, StatementCache& statements, TagIndex& tagIndex)
+    : m_db(db), m_statements(statements), m_tagIndex(tagIndex), m_stagedCount(0), m_stagedFamilyCount(0)
+{
+}
+
+bool BulkTagWriter::begin()
+{
+    const char* createSql = R"(
+        CREATE TEMP TABLE IF NOT EXISTS rms_staged_tags (
+            owner_id INTEGER PRIMARY KEY,
+            pid INTEGER NOT NULL,
+            name TEXT NOT NULL,
+            tag_id INTEGER
+        )
+    )";
+    // Family rows keep their rowid so tags are created in staging order
+    const char* createFamiliesSql = R"(
+        CREATE TEMP TABLE IF NOT EXISTS rms_staged_family_tags (
+            family_id INTEGER NOT NULL UNIQUE,
+            pid INTEGER NOT NULL,
+            name TEXT NOT NULL,
+            tag_id INTEGER
+        )
+    )";
+    if (!execute(createSql) || !execute(createFamiliesSql)) return false;
+
+    m_stagedCount = 0;
+    m_stagedFamilyCount = 0;
+    m_stagedKeys.clear();
+    return execute("DELETE FROM temp.rms_staged_tags") && execute("DELETE FROM temp.rms_staged_family_tags");
+}
+
+bool BulkTagWriter::stagePersonTag(int ownerId, int parentTagId, std::string_view name)
+{
+    if (!reserveName(parentTagId, name)) {
+        return false;
+    }
+
+    const char* stageSql = "INSERT INTO temp.rms_staged_tags (owner_id, pid, name) VALUES (?, ?, ?)";
+    CachedStatement stmt(m_statements, stageSql);
+    if (!stmt) {
+        logError() << "Failed to prepare staging SQL: " << sqlite3_errmsg(m_db) << std::endl;
+        return false;
+    }
+
+    sqlite3_bind_int(stmt, 1, ownerId);
+    sqlite3_bind_int(stmt, 2, parentTagId);
+    sqlite3_bind_text(stmt, 3, name.data(), static_cast<int>(name.size()), SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        logError() << "Failed to stage tag '" << name << "': " << sqlite3_errmsg(m_db) << std::endl;
+        return false;
+    }
+
+    m_stagedCount++;
+    return true;
+}
+
+bool BulkTagWriter::stageFamilyTag(int familyId, int parentTagId, std::string_view name)
+{
+    if (!reserveName(parentTagId, name)) {
+        return false;
+    }
+
+    const char* stageSql = "INSERT INTO temp.rms_staged_family_tags (family_id, pid, name) VALUES (?, ?, ?)";
+    CachedStatement stmt(m_statements, stageSql);
+    if (!stmt) {
+        logError() << "Failed to prepare staging SQL: " << sqlite3_errmsg(m_db) << std::endl;
+        return false;
+    }
+
+    sqlite3_bind_int(stmt, 1, familyId);
+    sqlite3_bind_int(stmt, 2, parentTagId);
+    sqlite3_bind_text(stmt, 3, name.data(), static_cast<int>(name.size()), SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        logError() << "Failed to stage family tag '" << name << "': " << sqlite3_errmsg(m_db) << std::endl;
+        return false;
+    }
+
+    m_stagedFamilyCount++;
+    return true;
+}
+
+bool BulkTagWriter::reserveName(int parentTagId, std::string_view name)
+{
+    // Tags is UNIQUE (name, pid); one clash would fail the whole batch insert
+    if (m_tagIndex.findChild(parentTagId, name) != 0) {
+        return false;
+    }
+    std::string stagedKey = std::to_string(parentTagId) + "/";
+    stagedKey.append(name);
+    return m_stagedKeys.insert(stagedKey).second;
+}
+
+bool BulkTagWriter::flush()
+{
+    m_created.clear();
+    m_createdFamilies.clear();
+    if (!flushFamilies()) return false;
+    if (m_stagedCount == 0) {
+        m_stagedKeys.clear();
+        return true;
+    }
+
+    const char* insertTagsSql = R"(
+        INSERT INTO Tags (name, pid, icon, iconkde)
+        SELECT name, pid, NULL, 'user' FROM temp.rms_staged_tags ORDER BY owner_id
+    )";
+    const char* recoverIdsSql = R"(
+        UPDATE temp.rms_staged_tags SET tag_id = t.id
+        FROM Tags t WHERE t.name = rms_staged_tags.name AND t.pid = rms_staged_tags.pid
+    )";
+    const char* insertOwnerIdsSql = R"(
+        INSERT INTO TagProperties (tagid, property, value)
+        SELECT tag_id, 'rootsmagic_owner_id', owner_id FROM temp.rms_staged_tags
+    )";
+    const char* insertPersonsSql = R"(
+        INSERT INTO TagProperties (tagid, property, value)
+        SELECT tag_id, 'person', name FROM temp.rms_staged_tags
+    )";
+
+    if (!execute(insertTagsSql) || !execute(recoverIdsSql) ||
+        !execute(insertOwnerIdsSql) || !execute(insertPersonsSql)) {
+        return false;
+    }
+
+    // Bring the index up to date with the rows just written
+    const char* createdSql = "SELECT owner_id, tag_id, pid, name FROM temp.rms_staged_tags";
+    {
+        CachedStatement stmt(m_statements, createdSql);
+        if (!stmt) return false;
+
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            int ownerId = sqlite3_column_int(stmt, 0);
+            int tagId = sqlite3_column_int(stmt, 1);
+            m_tagIndex.addTag(tagId, sqlite3_column_int(stmt, 2),
+                              reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)));
+            m_tagIndex.setOwnerId(tagId, ownerId);
+            m_created[ownerId] = tagId;
+        }
+    }
+
+    m_stagedCount = 0;
+    m_stagedKeys.clear();
+    return execute("DELETE FROM temp.rms_staged_tags");
+}
+
+bool BulkTagWriter::flushFamilies()
+{
+    if (m_stagedFamilyCount == 0) return true;
+
+    const char* insertTagsSql = R"(
+        INSERT INTO Tags (name, pid, icon, iconkde)
+        SELECT name, pid, NULL, 'user' FROM temp.rms_staged_family_tags ORDER BY rowid
+    )";
+    const char* recoverIdsSql = R"(
+        UPDATE temp.rms_staged_family_tags SET tag_id = t.id
+        FROM Tags t WHERE t.name = rms_staged_family_tags.name AND t.pid = rms_staged_family_tags.pid
+    )";
+    const char* insertFamilyIdsSql = R"(
+        INSERT INTO TagProperties (tagid, property, value)
+        SELECT tag_id, 'family_id', family_id FROM temp.rms_staged_family_tags
+    )";
+
+    if (!execute(insertTagsSql) || !execute(recoverIdsSql) || !execute(insertFamilyIdsSql)) {
+        return false;
+    }
+
+    const char* createdSql = "SELECT family_id, tag_id, pid, name FROM temp.rms_staged_family_tags";
+    {
+        CachedStatement stmt(m_statements, createdSql);
+        if (!stmt) return false;
+
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            int familyId = sqlite3_column_int(stmt, 0);
+            int tagId = sqlite3_column_int(stmt, 1);
+            m_tagIndex.addTag(tagId, sqlite3_column_int(stmt, 2),
+                              reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)));
+            m_tagIndex.setFamilyId(tagId, familyId);
+            m_createdFamilies[familyId] = tagId;
+        }
+    }
+
+    m_stagedFamilyCount = 0;
+    return execute("DELETE FROM temp.rms_staged_family_tags");
+}
+
+int BulkTagWriter::createdFamilyTagId(int familyId) const
+{
+    auto it = m_createdFamilies.find(familyId);
+    return it != m_createdFamilies.end() ? it->second : 0;
+}
+
+int BulkTagWriter::createdTagId(int ownerId) const
+{
+    auto it = m_created.find(ownerId);
+    return it != m_created.end() ? it->second : 0;
+}
+
+bool BulkTagWriter::execute(const char* sql)
+{
+    CachedStatement stmt(m_statements, sql);
+    if (!stmt || sqlite3_step(stmt) != SQLITE_DONE) {
+        logError() << "Bulk tag write failed: " << sqlite3_errmsg(m_db) << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,174 @@
+#include "connectionprofile.h"
+#include "logger.h"
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+// Reads the single value a PRAGMA returns, as text
+bool queryPragma(sqlite3* db, const std::string& sql, std::string& value)
+{
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        const unsigned char* text = sqlite3_column_text(stmt, 0);
+        value = text ? reinterpret_cast<const char*>(text) : "";
+    } else {
+        value.clear();
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_ROW || rc == SQLITE_DONE;
+}
+
+bool queryPragma(sqlite3* db, const std::string& sql, int& value)
+{
+    std::string text;
+    if (!queryPragma(db, sql, text) || text.empty()) {
+        return false;
+    }
+    value = std::atoi(text.c_str());
+    return true;
+}
+
+bool setPragma(sqlite3* db, const std::string& sql)
+{
+    std::string ignored;
+    if (!queryPragma(db, sql, ignored)) {
+        logWarning() << "Warning: " << sql << " failed: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// SQLite URI for a file path, so query parameters can be added to it
+std::string fileUri(const std::string& path)
+{
+    std::string uri = "file:";
+    for (char c : path) {
+        switch (c) {
+        case '%': uri += "%25"; break;
+        case '?': uri += "%3f"; break;
+        case '#': uri += "%23"; break;
+#ifdef _WIN32
+        case '\\': uri += '/'; break;
+#endif
+        default: uri += c;
+        }
+    }
+    // A leading "//" would be read as an authority
+    if (path.compare(0, 2, "//") == 0) {
+        uri.insert(5, "//");
+    }
+    return uri;
+}
+
+}
+
+const char* connectionProfileName(ConnectionProfile profile)
+{
+    switch (profile) {
+    case ConnectionProfile::Safe: return "safe";
+    case ConnectionProfile::Fast: return "fast";
+    case ConnectionProfile::Bulk: return "bulk";
+    default: return "unknown";
+    }
+}
+
+bool parseConnectionProfile(std::string_view name, ConnectionProfile& profile)
+{
+    for (ConnectionProfile candidate : {ConnectionProfile::Safe, ConnectionProfile::Fast, ConnectionProfile::Bulk}) {
+        if (name == connectionProfileName(candidate)) {
+            profile = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+ConnectionSettings ConnectionSettings::forProfile(ConnectionProfile profile)
+{
+    switch (profile) {
+    case ConnectionProfile::Fast:
+        return {false, 256LL << 20, -64 * 1024, true, nullptr, "NORMAL"};
+    case ConnectionProfile::Bulk:
+        return {true, 1LL << 30, -256 * 1024, true, "MEMORY", "OFF"};
+    case ConnectionProfile::Safe:
+    default:
+        return {false, 0, 0, false, nullptr, nullptr};
+    }
+}
+
+int openReadConnection(const std::string& path, const ConnectionSettings& settings, sqlite3** db)
+{
+    int rc;
+    if (settings.immutableRead && !path.empty() && path != ":memory:") {
+        rc = sqlite3_open_v2((fileUri(path) + "?immutable=1").c_str(), db,
+                             SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, nullptr);
+    } else {
+        rc = sqlite3_open_v2(path.c_str(), db, SQLITE_OPEN_READONLY, nullptr);
+    }
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+
+    // Tuning is best effort; a connection without it still reads correctly
+    if (settings.mmapSize > 0) {
+        setPragma(*db, "PRAGMA mmap_size=" + std::to_string(settings.mmapSize));
+    }
+    if (settings.cacheSize != 0) {
+        setPragma(*db, "PRAGMA cache_size=" + std::to_string(settings.cacheSize));
+    }
+    if (settings.tempStoreMemory) {
+        setPragma(*db, "PRAGMA temp_store=MEMORY");
+    }
+    return SQLITE_OK;
+}
+
+ConnectionTuning::ConnectionTuning(sqlite3* db, const ConnectionSettings& settings)
+    : m_db(db), m_previousSynchronous(0), m_previousCacheSize(0), m_previousTempStore(0),
+      m_changedJournalMode(false), m_changedSynchronous(false), m_changedCacheSize(false), m_changedTempStore(false)
+{
+    if (settings.cacheSize != 0 && queryPragma(m_db, "PRAGMA cache_size", m_previousCacheSize)) {
+        m_changedCacheSize = setPragma(m_db, "PRAGMA cache_size=" + std::to_string(settings.cacheSize));
+    }
+    if (settings.tempStoreMemory && queryPragma(m_db, "PRAGMA temp_store", m_previousTempStore)) {
+        m_changedTempStore = setPragma(m_db, "PRAGMA temp_store=MEMORY");
+    }
+    if (settings.synchronous && queryPragma(m_db, "PRAGMA synchronous", m_previousSynchronous)) {
+        m_changedSynchronous = setPragma(m_db, std::string("PRAGMA synchronous=") + settings.synchronous);
+    }
+
+    queryPragma(m_db, "PRAGMA journal_mode", m_previousJournalMode);
+    m_journalMode = m_previousJournalMode;
+    if (settings.journalMode && queryPragma(m_db, std::string("PRAGMA journal_mode=") + settings.journalMode, m_journalMode)) {
+        m_changedJournalMode = !m_previousJournalMode.empty() && m_journalMode != m_previousJournalMode;
+
+        // SQLite answers with the mode it kept when it can't switch, e.g. WAL with other connections open
+        std::string requested = settings.journalMode;
+        for (char& c : requested) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (m_journalMode != requested) {
+            logWarning() << "Warning: DigiKam database stays in journal mode " << m_journalMode
+                         << " instead of " << requested << std::endl;
+        }
+    }
+}
+
+ConnectionTuning::~ConnectionTuning()
+{
+    if (m_changedJournalMode) {
+        setPragma(m_db, "PRAGMA journal_mode=" + m_previousJournalMode);
+    }
+    if (m_changedSynchronous) {
+        setPragma(m_db, "PRAGMA synchronous=" + std::to_string(m_previousSynchronous));
+    }
+    if (m_changedTempStore) {
+        setPragma(m_db, "PRAGMA temp_store=" + std::to_string(m_previousTempStore));
+    }
+    if (m_changedCacheSize) {
+        setPragma(m_db, "PRAGMA cache_size=" + std::to_string(m_previousCacheSize));
+    }
+}
@@ -0,0 +1,388 @@
+#include "dbbackup.h"
+#include "logger.h"
+#include "sqlite3.h"
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* kBackupExtension = ".bak";
+const char* kCompressedSuffix = ".gz";
+const char* kPartialSuffix = ".partial";
+
+// Give up on a database another process keeps locked for this long
+const int kBusyRetries = 200;
+const int kBusySleepMs = 50;
+
+struct BackupFile {
+    fs::path path;
+    std::string stamp;  // yyyymmdd_hhmmss, with _N appended for several in one second
+};
+
+bool endsWith(const std::string& text, const std::string& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Backups of databaseName in directory, newest first
+std::vector<BackupFile> listBackups(const fs::path& directory, const std::string& databaseName)
+{
+    std::vector<BackupFile> backups;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().u8string();
+        if (name.compare(0, databaseName.size() + 1, databaseName + ".") != 0) continue;
+
+        std::string rest = name.substr(databaseName.size() + 1);
+        if (endsWith(rest, kCompressedSuffix)) {
+            rest.erase(rest.size() - std::char_traits<char>::length(kCompressedSuffix));
+        }
+        if (!endsWith(rest, kBackupExtension)) continue;
+        rest.erase(rest.size() - std::char_traits<char>::length(kBackupExtension));
+
+        if (rest.size() < 15 || rest[8] != '_') continue;
+        backups.push_back({entry.path(), rest});
+    }
+
+    std::sort(backups.begin(), backups.end(), [](const BackupFile& a, const BackupFile& b) {
+        return a.stamp > b.stamp;
+    });
+    return backups;
+}
+
+std::string timestamp()
+{
+    std::time_t now = std::time(nullptr);
+    char text[32] = "";
+    std::strftime(text, sizeof(text), "%Y%m%d_%H%M%S", std::localtime(&now));
+    return text;
+}
+
+std::optional<fs::file_time_type> modificationTime(const fs::path& path)
+{
+    std::error_code error;
+    fs::file_time_type time = fs::last_write_time(path, error);
+    if (error) {
+        return std::nullopt;
+    }
+    return time;
+}
+
+// Copies every page of source into destination. Each step takes the source's
+// read lock only for pagesPerStep pages; if another connection writes to the
+// source in between, SQLite restarts the copy so the result stays consistent.
+bool copyPages(sqlite3* source, sqlite3* destination, int pagesPerStep, const char* label)
+{
+    sqlite3_backup* backup = sqlite3_backup_init(destination, "main", source, "main");
+    if (!backup) {
+        logError() << "Failed to start " << label << ": " << sqlite3_errmsg(destination) << std::endl;
+        return false;
+    }
+
+    std::optional<ProgressReporter> progress;
+    int copiedPages = 0;
+    int busyRetries = 0;
+    int rc;
+    while (true) {
+        rc = sqlite3_backup_step(backup, pagesPerStep);
+        if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            if (++busyRetries > kBusyRetries) break;
+            sqlite3_sleep(kBusySleepMs);
+            continue;
+        }
+        if (rc != SQLITE_OK && rc != SQLITE_DONE) break;
+        busyRetries = 0;
+
+        int totalPages = sqlite3_backup_pagecount(backup);
+        int donePages = totalPages - sqlite3_backup_remaining(backup);
+        if (!progress) {
+            progress.emplace(logInfo(), label, "pages", static_cast<size_t>(totalPages));
+        }
+        if (donePages > copiedPages) {
+            progress->advance(static_cast<size_t>(donePages - copiedPages));
+            copiedPages = donePages;
+        }
+        if (rc == SQLITE_DONE) break;
+    }
+
+    int finishRc = sqlite3_backup_finish(backup);
+    if (rc != SQLITE_DONE || finishRc != SQLITE_OK) {
+        logError() << "Failed to copy database pages for " << label << ": "
+                   << (rc == SQLITE_BUSY || rc == SQLITE_LOCKED ? "database is locked" : sqlite3_errmsg(destination))
+                   << std::endl;
+        return false;
+    }
+    return true;
+}
+
+sqlite3* openDatabase(const fs::path& path, int flags)
+{
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(path.u8string().c_str(), &db, flags, nullptr) != SQLITE_OK) {
+        logError() << "Failed to open " << path.u8string() << ": " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return nullptr;
+    }
+    return db;
+}
+
+bool pragmaText(sqlite3* db, const std::string& sql, std::string& value)
+{
+    sqlite3_stmt* stmt = nullptr;
+    bool success = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK &&
+                   sqlite3_step(stmt) == SQLITE_ROW;
+    if (success) {
+        const unsigned char* text = sqlite3_column_text(stmt, 0);
+        value = text ? reinterpret_cast<const char*>(text) : "";
+    }
+    sqlite3_finalize(stmt);
+    return success;
+}
+
+// Backups are written as standalone files in rollback journal mode, even of a
+// WAL database; a restored database keeps the journal mode it had before.
+bool copyDatabase(const fs::path& from, const fs::path& to, bool restoring, int pagesPerStep, const char* label)
+{
+    sqlite3* source = openDatabase(from, SQLITE_OPEN_READONLY);
+    if (!source) {
+        return false;
+    }
+    sqlite3* destination = openDatabase(to, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    std::string journalMode = "delete";
+    if (destination && restoring) {
+        pragmaText(destination, "PRAGMA journal_mode", journalMode);
+    }
+
+    bool success = destination && copyPages(source, destination, pagesPerStep, label);
+    std::string resultMode;
+    if (success && !pragmaText(destination, "PRAGMA journal_mode=" + journalMode, resultMode)) {
+        logWarning() << "Warning: Failed to set journal mode of " << to.u8string() << ": "
+                     << sqlite3_errmsg(destination) << std::endl;
+    }
+    sqlite3_close(destination);
+    sqlite3_close(source);
+    return success;
+}
+
+#ifdef HAVE_ZLIB
+gzFile openGz(const fs::path& path, const char* mode)
+{
+#ifdef _WIN32
+    return gzopen_w(path.c_str(), mode);
+#else
+    return gzopen(path.c_str(), mode);
+#endif
+}
+
+bool compressFile(const fs::path& from, const fs::path& to)
+{
+    std::ifstream in(from, std::ios::binary);
+    gzFile out = openGz(to, "wb6");
+    if (!in || !out) {
+        if (out) gzclose(out);
+        return false;
+    }
+
+    std::vector<char> buffer(1 << 20);
+    bool success = true;
+    while (success && in) {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        int count = static_cast<int>(in.gcount());
+        success = count == 0 || gzwrite(out, buffer.data(), static_cast<unsigned>(count)) == count;
+    }
+    return gzclose(out) == Z_OK && success && in.eof();
+}
+
+bool decompressFile(const fs::path& from, const fs::path& to)
+{
+    gzFile in = openGz(from, "rb");
+    std::ofstream out(to, std::ios::binary | std::ios::trunc);
+    if (!in || !out) {
+        if (in) gzclose(in);
+        return false;
+    }
+
+    std::vector<char> buffer(1 << 20);
+    int count;
+    while ((count = gzread(in, buffer.data(), static_cast<unsigned>(buffer.size()))) > 0) {
+        out.write(buffer.data(), count);
+    }
+    return gzclose(in) == Z_OK && count == 0 && static_cast<bool>(out.flush());
+}
+#endif
+
+void removeFile(const fs::path& path)
+{
+    std::error_code error;
+    fs::remove(path, error);
+}
+
+}
+
+bool backupCompressionAvailable()
+{
+#ifdef HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool backupDatabase(const std::string& databasePath, const BackupOptions& options, std::string& backupPath)
+{
+    fs::path database = fs::u8path(databasePath);
+    fs::path directory = options.directory.empty() ? database.parent_path() : fs::u8path(options.directory);
+    if (directory.empty()) {
+        directory = ".";
+    }
+    std::string databaseName = database.filename().u8string();
+
+    if (options.compress && !backupCompressionAvailable()) {
+        logError() << "Compressed backups need a build with zlib" << std::endl;
+        return false;
+    }
+
+    std::optional<fs::file_time_type> databaseTime = modificationTime(database);
+    if (!databaseTime) {
+        logError() << "Cannot back up " << databasePath << ": file not found" << std::endl;
+        return false;
+    }
+    std::error_code error;
+    fs::create_directories(directory, error);
+
+    // Each backup's time stamp is set to when its copy started, so a database
+    // (and WAL file) last written before then is exactly what the backup holds
+    std::vector<BackupFile> backups = listBackups(directory, databaseName);
+    if (!backups.empty()) {
+        std::optional<fs::file_time_type> backupTime = modificationTime(backups.front().path);
+        std::optional<fs::file_time_type> walTime = modificationTime(fs::u8path(databasePath + "-wal"));
+        if (backupTime && *databaseTime < *backupTime && (!walTime || *walTime < *backupTime)) {
+            backupPath = backups.front().path.u8string();
+            logInfo() << "DigiKam database unchanged since backup " << backupPath << std::endl;
+            return true;
+        }
+    }
+
+    std::string stamp = timestamp();
+    fs::path target;
+    for (int attempt = 1; ; attempt++) {
+        std::string name = databaseName + "." + stamp + (attempt > 1 ? "_" + std::to_string(attempt) : "") + kBackupExtension;
+        target = directory / fs::u8path(options.compress ? name + kCompressedSuffix : name);
+        if (!fs::exists(directory / fs::u8path(name), error) &&
+            !fs::exists(directory / fs::u8path(name + kCompressedSuffix), error)) break;
+    }
+
+    // Written under a temporary name so an interrupted copy never looks like a backup
+    fs::path copy = target;
+    if (options.compress) {
+        copy.replace_extension();  // Drop ".gz"
+    }
+    copy += kPartialSuffix;
+    removeFile(copy);
+
+    logInfo() << "Backing up DigiKam database to " << target.u8string() << "..." << std::endl;
+    fs::file_time_type started = fs::file_time_type::clock::now();
+    bool success = copyDatabase(database, copy, false, options.pagesPerStep, "Backup Progress");
+
+#ifdef HAVE_ZLIB
+    if (success && options.compress) {
+        fs::path compressed = target;
+        compressed += kPartialSuffix;
+        success = compressFile(copy, compressed);
+        removeFile(copy);
+        copy = compressed;
+        if (!success) {
+            logError() << "Failed to compress backup " << target.u8string() << std::endl;
+        }
+    }
+#endif
+
+    if (success) {
+        fs::rename(copy, target, error);
+        if (error) {
+            logError() << "Failed to rename backup to " << target.u8string() << ": " << error.message() << std::endl;
+            success = false;
+        }
+    }
+    if (!success) {
+        removeFile(copy);
+        return false;
+    }
+    fs::last_write_time(target, started, error);
+    backupPath = target.u8string();
+    logInfo() << "Backup created: " << backupPath << std::endl;
+
+    // Retention: the new backup is among the listed ones from here on
+    backups = listBackups(directory, databaseName);
+    for (size_t i = static_cast<size_t>(std::max(options.keep, 1)); i < backups.size(); i++) {
+        removeFile(backups[i].path);
+        logInfo() << "Removed old backup " << backups[i].path.u8string() << std::endl;
+    }
+    return true;
+}
+
+bool restoreDatabase(const std::string& backupPath, const std::string& databasePath)
+{
+    fs::path backup = fs::u8path(backupPath);
+    std::error_code error;
+    if (!fs::exists(backup, error)) {
+        logError() << "Backup not found: " << backupPath << std::endl;
+        return false;
+    }
+
+    fs::path source = backup;
+    fs::path expanded;
+    if (endsWith(backupPath, kCompressedSuffix)) {
+#ifdef HAVE_ZLIB
+        expanded = fs::u8path(databasePath + ".restore" + kPartialSuffix);
+        if (!decompressFile(backup, expanded)) {
+            logError() << "Failed to decompress backup " << backupPath << std::endl;
+            removeFile(expanded);
+            return false;
+        }
+        source = expanded;
+#else
+        logError() << "Compressed backups need a build with zlib" << std::endl;
+        return false;
+#endif
+    }
+
+    // A damaged backup would replace a good database with a bad one
+    bool success = false;
+    if (sqlite3* db = openDatabase(source, SQLITE_OPEN_READONLY)) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, "PRAGMA quick_check", -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW) {
+            const unsigned char* result = sqlite3_column_text(stmt, 0);
+            success = result && std::string(reinterpret_cast<const char*>(result)) == "ok";
+        }
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        if (!success) {
+            logError() << "Backup " << backupPath << " failed its integrity check" << std::endl;
+        }
+    }
+
+    if (success) {
+        logInfo() << "Restoring " << databasePath << " from " << backupPath << "..." << std::endl;
+        success = copyDatabase(source, fs::u8path(databasePath), true, BackupOptions().pagesPerStep, "Restore Progress");
+    }
+    if (!expanded.empty()) {
+        removeFile(expanded);
+    }
+    if (success) {
+        logInfo() << "Restored " << databasePath << " from " << backupPath << std::endl;
+    }
+    return success;
+}
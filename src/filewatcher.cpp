@@ -0,0 +1,146 @@
+#include "filewatcher.h"
+#include "logger.h"
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+FileWatcher::FileWatcher(const std::string& databasePath, std::chrono::milliseconds pollInterval)
+    : m_paths{databasePath, databasePath + "-wal", databasePath + "-journal"}, m_pollInterval(pollInterval),
+#ifdef _WIN32
+      m_notification(nullptr)
+#else
+      m_inotifyFd(-1)
+#endif
+{
+    fs::path directory = fs::absolute(fs::path(databasePath)).parent_path();
+
+#ifdef _WIN32
+    HANDLE handle = FindFirstChangeNotificationW(directory.wstring().c_str(), FALSE,
+                                                 FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE |
+                                                 FILE_NOTIFY_CHANGE_FILE_NAME);
+    if (handle != INVALID_HANDLE_VALUE) {
+        m_notification = handle;
+    } else {
+        logWarning() << "Warning: Cannot watch " << directory.string() << " for changes, polling instead" << std::endl;
+    }
+#elif defined(__linux__)
+    // The directory is watched because SQLite creates and deletes the journal files
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd >= 0 &&
+        inotify_add_watch(m_inotifyFd, directory.c_str(),
+                          IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_ATTRIB) < 0) {
+        close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+    if (m_inotifyFd < 0) {
+        logWarning() << "Warning: Cannot watch " << directory.string() << " with inotify, polling instead" << std::endl;
+    }
+#endif
+
+    m_stamps = readStamps();
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef _WIN32
+    if (m_notification) {
+        FindCloseChangeNotification(m_notification);
+    }
+#else
+    if (m_inotifyFd >= 0) {
+        close(m_inotifyFd);
+    }
+#endif
+}
+
+const char* FileWatcher::mechanism() const
+{
+#ifdef _WIN32
+    return m_notification ? "change notifications" : "polling";
+#else
+    return m_inotifyFd >= 0 ? "inotify" : "polling";
+#endif
+}
+
+bool FileWatcher::waitForChange(std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        if (stampsChanged()) {
+            return true;
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining <= std::chrono::milliseconds::zero()) {
+            return false;
+        }
+        waitForNotification(remaining);
+    }
+}
+
+std::vector<FileWatcher::FileStamp> FileWatcher::readStamps() const
+{
+    std::vector<FileStamp> stamps;
+    stamps.reserve(m_paths.size());
+    for (const std::string& path : m_paths) {
+        // Missing files get a zero stamp, so creating or deleting one is a change too
+        std::error_code error;
+        FileStamp stamp = {0, 0};
+        auto size = fs::file_size(path, error);
+        if (!error) {
+            stamp.size = static_cast<long long>(size);
+            auto modified = fs::last_write_time(path, error);
+            if (!error) {
+                stamp.modified = static_cast<long long>(modified.time_since_epoch().count());
+            }
+        }
+        stamps.push_back(stamp);
+    }
+    return stamps;
+}
+
+bool FileWatcher::stampsChanged()
+{
+    std::vector<FileStamp> stamps = readStamps();
+    if (stamps == m_stamps) {
+        return false;
+    }
+    m_stamps = std::move(stamps);
+    return true;
+}
+
+void FileWatcher::waitForNotification(std::chrono::milliseconds timeout)
+{
+#ifdef _WIN32
+    if (m_notification) {
+        if (WaitForSingleObject(m_notification, static_cast<DWORD>(timeout.count())) == WAIT_OBJECT_0) {
+            FindNextChangeNotification(m_notification);
+        }
+        return;
+    }
+#elif defined(__linux__)
+    if (m_inotifyFd >= 0) {
+        pollfd descriptor = {m_inotifyFd, POLLIN, 0};
+        if (poll(&descriptor, 1, static_cast<int>(timeout.count())) > 0) {
+            // Only the wake-up matters; the events themselves are dropped
+            char buffer[4096];
+            while (read(m_inotifyFd, buffer, sizeof(buffer)) > 0) {
+            }
+        }
+        return;
+    }
+#endif
+    std::this_thread::sleep_for(std::min(timeout, m_pollInterval));
+}
@@ -0,0 +1,52 @@
+#include "heapstats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+std::atomic<size_t> g_liveBytes{0};
+std::atomic<size_t> g_peakBytes{0};
+
+// Each block carries its size in front so delete can keep the live count
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+void* countedAllocate(size_t size)
+{
+    void* raw = std::malloc(size + kHeaderSize);
+    if (!raw) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(raw) = size;
+
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t live = g_liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = g_peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !g_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return static_cast<char*>(raw) + kHeaderSize;
+}
+
+void countedFree(void* ptr) noexcept
+{
+    if (!ptr) return;
+
+    char* raw = static_cast<char*>(ptr) - kHeaderSize;
+    g_liveBytes.fetch_sub(*reinterpret_cast<size_t*>(raw), std::memory_order_relaxed);
+    std::free(raw);
+}
+
+}
+
+HeapStatistics heapStatistics()
+{
+    return HeapStatistics{g_allocations.load(), g_peakBytes.load(), g_liveBytes.load()};
+}
+
+void* operator new(size_t size) { return countedAllocate(size); }
+void* operator new[](size_t size) { return countedAllocate(size); }
+void operator delete(void* ptr) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { countedFree(ptr); }
@@ -0,0 +1,206 @@
+#include "logger.h"
+#include <iostream>
+#include <utility>
+
+namespace {
+
+// Hands complete lines to the logger at a fixed level
+class LineBuffer : public std::streambuf {
+public:
+    explicit LineBuffer(LogLevel level) : m_level(level) {}
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        m_line.push_back(traits_type::to_char_type(c));
+        if (c == '\n') {
+            emit();
+        }
+        return c;
+    }
+
+    std::streamsize xsputn(const char* text, std::streamsize count) override
+    {
+        m_line.append(text, static_cast<size_t>(count));
+        if (std::string_view(text, static_cast<size_t>(count)).find('\n') != std::string_view::npos) {
+            emit();
+        }
+        return count;
+    }
+
+private:
+    // Everything up to the last newline goes out; a partial line waits for the rest
+    void emit()
+    {
+        size_t end = m_line.rfind('\n') + 1;
+        Logger::instance().write(m_level, std::string_view(m_line.data(), end));
+        m_line.erase(0, end);
+    }
+
+    LogLevel m_level;
+    std::string m_line;
+};
+
+class LevelStream : public std::ostream {
+public:
+    explicit LevelStream(LogLevel level) : std::ostream(nullptr), m_level(level), m_buffer(level)
+    {
+        rdbuf(&m_buffer);
+    }
+
+    std::ostream& enabled()
+    {
+        clear(Logger::instance().isEnabled(m_level) ? std::ios::goodbit : std::ios::badbit);
+        return *this;
+    }
+
+private:
+    LogLevel m_level;
+    LineBuffer m_buffer;
+};
+
+}
+
+Logger& Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : m_level(LogLevel::Info)
+{
+    m_pending.reserve(kBufferSize);
+}
+
+Logger::~Logger()
+{
+    flush();
+}
+
+void Logger::write(LogLevel level, std::string_view text)
+{
+    if (!isEnabled(level)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_sink) {
+        while (!text.empty()) {
+            size_t end = text.find('\n');
+            m_sink(level, text.substr(0, end));
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        }
+        return;
+    }
+    if (level <= LogLevel::Warning) {
+        writePending();
+        std::cout.flush();
+        std::cerr.write(text.data(), static_cast<std::streamsize>(text.size()));
+        return;
+    }
+
+    m_pending.append(text);
+    if (m_pending.size() >= kBufferSize) {
+        writePending();
+    }
+}
+
+void Logger::flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    writePending();
+    std::cout.flush();
+}
+
+void Logger::setSink(Sink sink)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    writePending();
+    std::cout.flush();
+    m_sink = std::move(sink);
+}
+
+void Logger::setProgressCallback(ProgressCallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_progressMutex);
+    m_progressCallback = std::move(callback);
+}
+
+void Logger::reportProgress(std::string_view label, size_t done, size_t total)
+{
+    std::lock_guard<std::mutex> lock(m_progressMutex);
+    if (m_progressCallback) {
+        m_progressCallback(label, done, total);
+    }
+}
+
+void Logger::writePending()
+{
+    if (!m_pending.empty()) {
+        std::cout.write(m_pending.data(), static_cast<std::streamsize>(m_pending.size()));
+        m_pending.clear();
+    }
+}
+
+std::ostream& logError()
+{
+    thread_local LevelStream stream(LogLevel::Error);
+    return stream.enabled();
+}
+
+std::ostream& logWarning()
+{
+    thread_local LevelStream stream(LogLevel::Warning);
+    return stream.enabled();
+}
+
+std::ostream& logInfo()
+{
+    thread_local LevelStream stream(LogLevel::Info);
+    return stream.enabled();
+}
+
+std::ostream& logDebug()
+{
+    thread_local LevelStream stream(LogLevel::Debug);
+    return stream.enabled();
+}
+
+ProgressReporter::ProgressReporter(std::ostream& log, const char* label, const char* unit, size_t total,
+                                   std::chrono::milliseconds interval)
+    : m_log(log), m_label(label), m_unit(unit), m_total(total), m_done(0), m_interval(interval),
+      m_lastReport(std::chrono::steady_clock::now())
+{
+}
+
+void ProgressReporter::advance(size_t count)
+{
+    m_done += count;
+    if (m_done >= m_total) {
+        if (m_done - count < m_total) {
+            report();
+        }
+        return;
+    }
+
+    // Checking the clock costs a few nanoseconds; only every 64th step bothers
+    if ((m_done & 63) != 0) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_lastReport >= m_interval) {
+        m_lastReport = now;
+        report();
+    }
+}
+
+void ProgressReporter::report()
+{
+    Logger::instance().reportProgress(m_label, m_done, m_total);
+    size_t percent = m_total ? (m_done * 100) / m_total : 100;
+    m_log << m_label << ": " << percent << "% (" << m_done << "/" << m_total << " " << m_unit << ")\n";
+}
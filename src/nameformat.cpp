@@ -0,0 +1,210 @@
+#include "nameformat.h"
+#include "rootsmagicsync.h"
+#include <charconv>
+#include <iterator>
+
+const char* const NameFormat::kDefaultPersonFormat = "{given} {surname} {birth}-{death} (OwnerID: {id})";
+const char* const NameFormat::kDefaultFamilyFormat = "{father} and {mother} Family (FamilyID: {id})";
+
+namespace {
+
+void appendNumber(std::string& out, int value)
+{
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr - digits);
+}
+
+void appendYear(std::string& out, int year)
+{
+    if (year == 0) {
+        out.append("unknown");
+    } else {
+        appendNumber(out, year);
+    }
+}
+
+void appendParent(std::string& out, std::string_view given, std::string_view surname, int ownerId)
+{
+    if ((given.empty() && surname.empty()) || ownerId == 0) {
+        out.append("unknown");
+        return;
+    }
+    out.append(given).append(" ").append(surname).append(" (OwnerID: ");
+    appendNumber(out, ownerId);
+    out.append(")");
+}
+
+}
+
+bool NameFormat::parsePerson(std::string_view text, std::string& error)
+{
+    static const FieldName fields[] = {
+        {"given", Field::Given},
+        {"surname", Field::Surname},
+        {"birth", Field::BirthYear},
+        {"death", Field::DeathYear},
+        {"id", Field::OwnerId},
+    };
+    return parse(text, fields, std::size(fields), error);
+}
+
+bool NameFormat::parseFamily(std::string_view text, std::string& error)
+{
+    static const FieldName fields[] = {
+        {"father", Field::Father},
+        {"mother", Field::Mother},
+        {"id", Field::FamilyId},
+        {"father_given", Field::FatherGiven},
+        {"father_surname", Field::FatherSurname},
+        {"father_id", Field::FatherId},
+        {"mother_given", Field::MotherGiven},
+        {"mother_surname", Field::MotherSurname},
+        {"mother_id", Field::MotherId},
+    };
+    return parse(text, fields, std::size(fields), error);
+}
+
+bool NameFormat::parse(std::string_view text, const FieldName* fields, size_t fieldCount, std::string& error)
+{
+    std::string literals;
+    std::vector<Instruction> instructions;
+
+    // Adjacent literal characters are merged into one run
+    auto appendLiteral = [&](std::string_view literal) {
+        if (instructions.empty() || instructions.back().field != Field::Literal) {
+            instructions.push_back({Field::Literal, static_cast<uint32_t>(literals.size()), 0});
+        }
+        literals.append(literal);
+        instructions.back().length += static_cast<uint32_t>(literal.size());
+    };
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if ((c == '{' || c == '}') && pos + 1 < text.size() && text[pos + 1] == c) {
+            appendLiteral(text.substr(pos, 1));
+            pos += 2;
+            continue;
+        }
+        if (c == '}') {
+            error = "unmatched '}' at position " + std::to_string(pos);
+            return false;
+        }
+        if (c != '{') {
+            size_t next = text.find_first_of("{}", pos);
+            if (next == std::string_view::npos) next = text.size();
+            appendLiteral(text.substr(pos, next - pos));
+            pos = next;
+            continue;
+        }
+
+        size_t close = text.find('}', pos);
+        if (close == std::string_view::npos) {
+            error = "unterminated '{' at position " + std::to_string(pos);
+            return false;
+        }
+        std::string_view name = text.substr(pos + 1, close - pos - 1);
+        const FieldName* match = nullptr;
+        for (size_t i = 0; i < fieldCount; i++) {
+            if (name == fields[i].name) {
+                match = &fields[i];
+                break;
+            }
+        }
+        if (!match) {
+            error = "unknown field {" + std::string(name) + "}";
+            return false;
+        }
+        instructions.push_back({match->field, 0, 0});
+        pos = close + 1;
+    }
+
+    if (instructions.empty()) {
+        error = "template is empty";
+        return false;
+    }
+
+    m_text = std::string(text);
+    m_literals = std::move(literals);
+    m_instructions = std::move(instructions);
+    return true;
+}
+
+bool NameFormat::includesId() const
+{
+    for (const auto& instruction : m_instructions) {
+        if (instruction.field == Field::OwnerId || instruction.field == Field::FamilyId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void NameFormat::render(const PersonRecord& person, std::string& out) const
+{
+    for (const auto& instruction : m_instructions) {
+        switch (instruction.field) {
+        case Field::Literal:
+            out.append(m_literals, instruction.offset, instruction.length);
+            break;
+        case Field::Given:
+            out.append(person.given);
+            break;
+        case Field::Surname:
+            out.append(person.surname);
+            break;
+        case Field::BirthYear:
+            appendYear(out, person.birthYear);
+            break;
+        case Field::DeathYear:
+            appendYear(out, person.deathYear);
+            break;
+        case Field::OwnerId:
+            appendNumber(out, person.ownerId);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void NameFormat::render(const FamilyRecord& family, std::string& out) const
+{
+    for (const auto& instruction : m_instructions) {
+        switch (instruction.field) {
+        case Field::Literal:
+            out.append(m_literals, instruction.offset, instruction.length);
+            break;
+        case Field::Father:
+            appendParent(out, family.fatherGiven, family.fatherSurname, family.fatherOwnerId);
+            break;
+        case Field::Mother:
+            appendParent(out, family.motherGiven, family.motherSurname, family.motherOwnerId);
+            break;
+        case Field::FamilyId:
+            appendNumber(out, family.familyId);
+            break;
+        case Field::FatherGiven:
+            out.append(family.fatherGiven);
+            break;
+        case Field::FatherSurname:
+            out.append(family.fatherSurname);
+            break;
+        case Field::FatherId:
+            appendNumber(out, family.fatherOwnerId);
+            break;
+        case Field::MotherGiven:
+            out.append(family.motherGiven);
+            break;
+        case Field::MotherSurname:
+            out.append(family.motherSurname);
+            break;
+        case Field::MotherId:
+            appendNumber(out, family.motherOwnerId);
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#include "rmnocase.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+const uint64_t kHighBits = 0x8080808080808080ull;
+const uint64_t kOnes = 0x0101010101010101ull;
+
+// Lowercases eight ASCII bytes at once. A byte gains its high bit from the first
+// add when it is >= 'A' and from the second when it is > 'Z'; neither add can
+// carry into the next byte while every byte is below 0x80.
+inline uint64_t foldAsciiWord(uint64_t word)
+{
+    uint64_t atLeastA = word + kOnes * (0x80 - 'A');
+    uint64_t aboveZ = word + kOnes * (0x80 - 'Z' - 1);
+    uint64_t upper = (atLeastA ^ aboveZ) & kHighBits;
+    return word | (upper >> 2);
+}
+
+inline uint32_t foldAscii(uint32_t c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+}
+
+// Simple case folding for the scripts found in genealogy data: Latin-1,
+// Latin Extended-A, Greek and Cyrillic. Other code points are left as they are.
+uint32_t foldCodePoint(uint32_t c)
+{
+    if (c < 0x80) {
+        return foldAscii(c);
+    }
+    if (c < 0x100) {
+        return (c >= 0xC0 && c <= 0xDE && c != 0xD7) ? c + 0x20 : c;
+    }
+    if (c < 0x180) {
+        if (c == 0x178) return 0xFF;  // Ÿ
+        if (c == 0x17F) return 's';   // long s
+        if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E)) {
+            return (c & 1) ? c + 1 : c;
+        }
+        if ((c >= 0x100 && c <= 0x12F) || (c >= 0x132 && c <= 0x137) || (c >= 0x14A && c <= 0x177)) {
+            return c | 1;
+        }
+        return c;
+    }
+    if (c >= 0x391 && c <= 0x3AB && c != 0x3A2) {
+        return c + 0x20;  // Greek capitals
+    }
+    if (c == 0x3C2) {
+        return 0x3C3;  // final sigma
+    }
+    if (c >= 0x400 && c <= 0x40F) {
+        return c + 0x50;  // Cyrillic capitals with diacritics
+    }
+    if (c >= 0x410 && c <= 0x42F) {
+        return c + 0x20;  // Basic Cyrillic capitals
+    }
+    if (c == 0x1E9E) {
+        return 0xDF;  // capital sharp s
+    }
+    return c;
+}
+
+// Decodes the code point at text[pos] and advances pos past it
+uint32_t decodeUtf8(const unsigned char* text, int length, int& pos)
+{
+    uint32_t lead = text[pos];
+    int extra;
+    uint32_t c;
+    if (lead < 0x80) {
+        pos++;
+        return lead;
+    } else if (lead >= 0xC2 && lead <= 0xDF) {
+        extra = 1;
+        c = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        extra = 2;
+        c = lead & 0x0F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        extra = 3;
+        c = lead & 0x07;
+    } else {
+        pos++;
+        return lead;
+    }
+
+    // Truncated or malformed sequences fall back to the lead byte alone
+    if (pos + extra >= length) {
+        pos++;
+        return lead;
+    }
+    for (int i = 1; i <= extra; i++) {
+        uint32_t next = text[pos + i];
+        if ((next & 0xC0) != 0x80) {
+            pos++;
+            return lead;
+        }
+        c = (c << 6) | (next & 0x3F);
+    }
+    pos += extra + 1;
+    return c;
+}
+
+}
+
+int rmnocaseCompare(const char* left, int leftLength, const char* right, int rightLength)
+{
+    const unsigned char* a = reinterpret_cast<const unsigned char*>(left);
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(right);
+    int i = 0;
+    int j = 0;
+
+    while (i < leftLength && j < rightLength) {
+        // Fast path: eight ASCII bytes on each side that fold to the same thing
+        if (i + 8 <= leftLength && j + 8 <= rightLength) {
+            uint64_t wordA;
+            uint64_t wordB;
+            std::memcpy(&wordA, a + i, sizeof(wordA));
+            std::memcpy(&wordB, b + j, sizeof(wordB));
+            if (((wordA | wordB) & kHighBits) == 0) {
+                if (foldAsciiWord(wordA) == foldAsciiWord(wordB)) {
+                    i += 8;
+                    j += 8;
+                    continue;
+                }
+                // The difference is somewhere in these bytes; the loop below finds it
+            }
+        }
+
+        uint32_t charA;
+        uint32_t charB;
+        if (a[i] < 0x80 && b[j] < 0x80) {
+            charA = foldAscii(a[i++]);
+            charB = foldAscii(b[j++]);
+        } else {
+            charA = foldCodePoint(decodeUtf8(a, leftLength, i));
+            charB = foldCodePoint(decodeUtf8(b, rightLength, j));
+        }
+        if (charA != charB) {
+            return charA < charB ? -1 : 1;
+        }
+    }
+
+    if (i < leftLength) return 1;
+    if (j < rightLength) return -1;
+    return 0;
+}
+
+int registerRmnocaseCollation(sqlite3* db)
+{
+    return sqlite3_create_collation(db, "RMNOCASE", SQLITE_UTF8, nullptr,
+                                    [](void*, int leftLength, const void* left, int rightLength, const void* right) {
+                                        return rmnocaseCompare(static_cast<const char*>(left), leftLength,
+                                                               static_cast<const char*>(right), rightLength);
+                                    });
+}
@@ -0,0 +1,136 @@
+// Micro-benchmark for the RMNOCASE collation: rmnocaseCompare against the
+// std::string + ::tolower comparison it replaced, called directly and through
+// SQLite sorting a table of names.
+#include "rmnocase.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The collation as it was originally registered
+int legacyCompare(void*, int len1, const void* data1, int len2, const void* data2)
+{
+    std::string s1((const char*)data1, len1);
+    std::string s2((const char*)data2, len2);
+    std::transform(s1.begin(), s1.end(), s1.begin(), ::tolower);
+    std::transform(s2.begin(), s2.end(), s2.begin(), ::tolower);
+    return s1.compare(s2);
+}
+
+int currentCompare(void*, int len1, const void* data1, int len2, const void* data2)
+{
+    return rmnocaseCompare(static_cast<const char*>(data1), len1, static_cast<const char*>(data2), len2);
+}
+
+std::vector<std::string> makeNames(size_t count)
+{
+    static const char* const given[] = {
+        "John", "Mary", "William", "Elizabeth", "Anna", "Sven", "Åsa", "Björn",
+        "Jörg", "Günther", "Søren", "Ingrid", "Karl-Heinz", "Margaretha", "Ægir", "Øystein"
+    };
+    static const char* const surnames[] = {
+        "Smith", "Johnson", "Huskey", "Andersson", "Ångström", "Müller", "Schröder",
+        "Østergaard", "Kjærsgaard", "Weißmüller", "Lindqvist", "MacDonald", "Van Der Berg"
+    };
+
+    std::mt19937 random(42);
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        std::string name = surnames[random() % std::size(surnames)];
+        name += ", ";
+        name += given[random() % std::size(given)];
+        if (random() % 3 == 0) {
+            // Same name in a different case, as RootsMagic users often type it
+            std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        }
+        names.push_back(std::move(name));
+    }
+    return names;
+}
+
+template <typename Compare>
+double timeComparisons(const std::vector<std::string>& names, int rounds, Compare compare, long long& checksum)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 1; i < names.size(); i++) {
+            const std::string& a = names[i - 1];
+            const std::string& b = names[i];
+            checksum += compare(nullptr, static_cast<int>(a.size()), a.data(), static_cast<int>(b.size()), b.data()) < 0;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (double(rounds) * (names.size() - 1));
+}
+
+double timeSqliteSort(const std::vector<std::string>& names, int (*compare)(void*, int, const void*, int, const void*))
+{
+    sqlite3* db = nullptr;
+    sqlite3_open(":memory:", &db);
+    sqlite3_create_collation(db, "RMNOCASE", SQLITE_UTF8, nullptr, compare);
+    sqlite3_exec(db, "CREATE TABLE names (name TEXT COLLATE RMNOCASE)", nullptr, nullptr, nullptr);
+
+    sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr);
+    sqlite3_stmt* insert = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO names (name) VALUES (?)", -1, &insert, nullptr);
+    for (const auto& name : names) {
+        sqlite3_bind_text(insert, 1, name.data(), static_cast<int>(name.size()), SQLITE_STATIC);
+        sqlite3_step(insert);
+        sqlite3_reset(insert);
+    }
+    sqlite3_finalize(insert);
+    sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    sqlite3_exec(db, "CREATE INDEX names_by_name ON names (name)", nullptr, nullptr, nullptr);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    sqlite3_close(db);
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    if (count < 2) count = 2;
+    const int rounds = 10;
+
+    std::vector<std::string> names = makeNames(count);
+
+    // The two must agree wherever case folding is ASCII-only
+    size_t disagreements = 0;
+    for (size_t i = 1; i < names.size(); i++) {
+        const std::string& a = names[i - 1];
+        const std::string& b = names[i];
+        bool ascii = std::all_of(a.begin(), a.end(), [](char c) { return (c & 0x80) == 0; }) &&
+                     std::all_of(b.begin(), b.end(), [](char c) { return (c & 0x80) == 0; });
+        if (!ascii) continue;
+        int legacy = legacyCompare(nullptr, int(a.size()), a.data(), int(b.size()), b.data());
+        int current = currentCompare(nullptr, int(a.size()), a.data(), int(b.size()), b.data());
+        if ((legacy < 0) != (current < 0) || (legacy == 0) != (current == 0)) {
+            disagreements++;
+        }
+    }
+
+    long long checksum = 0;
+    double legacyNs = timeComparisons(names, rounds, legacyCompare, checksum);
+    double currentNs = timeComparisons(names, rounds, currentCompare, checksum);
+    double legacySortMs = timeSqliteSort(names, legacyCompare);
+    double currentSortMs = timeSqliteSort(names, currentCompare);
+
+    std::cout << "RMNOCASE collation, " << count << " names\n";
+    std::cout << "  Direct compare:  legacy " << legacyNs << " ns, current " << currentNs << " ns ("
+              << legacyNs / currentNs << "x)\n";
+    std::cout << "  CREATE INDEX:    legacy " << legacySortMs << " ms, current " << currentSortMs << " ms ("
+              << legacySortMs / currentSortMs << "x)\n";
+    std::cout << "  ASCII disagreements: " << disagreements << " (checksum " << checksum << ")\n";
+    return disagreements == 0 ? 0 : 1;
+}
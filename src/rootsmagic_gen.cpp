@@ -0,0 +1,105 @@
+#include "syntheticdb.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+void printUsage(const char* programName) {
+    std::cout << "Synthetic RootsMagic and DigiKam database generator\n"
+              << "Usage: " << programName << " -r <rootsmagic_db> [-d <digikam_db>] [options]\n"
+              << "Options:\n"
+              << "  -r, --rootsmagic     RootsMagic database to create (replaced if it exists)\n"
+              << "  -d, --digikam        DigiKam database to create from the RootsMagic people\n"
+              << "  -n, --people N       Number of people (default: 10000)\n"
+              << "      --seed N         Random seed (default: 1)\n"
+              << "      --tagged F       Share of people already tagged under RootsMagic (default: 0)\n"
+              << "      --lost-found F   Share of people whose tag is in Lost & Found (default: 0)\n"
+              << "      --stale F        Share of existing tags with an outdated name (default: 0)\n"
+              << "      --orphans N      Tags for people not in RootsMagic (default: 0)\n"
+              << "  -h, --help           Show this help message\n\n"
+              << "Example:\n"
+              << "  " << programName << " -r synthetic.rmtree -d digikam4.db -n 100000 --tagged 0.5 --stale 0.1\n";
+}
+
+int main(int argc, char* argv[])
+{
+    std::string rootsMagicDbPath;
+    std::string digiKamDbPath;
+    SyntheticTreeOptions tree;
+    SyntheticTagOptions tags;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-r" || arg == "--rootsmagic") && i + 1 < argc) {
+            rootsMagicDbPath = argv[++i];
+        }
+        else if ((arg == "-d" || arg == "--digikam") && i + 1 < argc) {
+            digiKamDbPath = argv[++i];
+        }
+        else if ((arg == "-n" || arg == "--people") && i + 1 < argc) {
+            long long people = std::atoll(argv[++i]);
+            if (people <= 0) {
+                std::cerr << "Error: --people must be a positive number\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+            tree.people = static_cast<size_t>(people);
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            tree.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+            tags.seed = tree.seed;
+        }
+        else if (arg == "--tagged" && i + 1 < argc) {
+            tags.taggedFraction = std::atof(argv[++i]);
+        }
+        else if (arg == "--lost-found" && i + 1 < argc) {
+            tags.lostFoundFraction = std::atof(argv[++i]);
+        }
+        else if (arg == "--stale" && i + 1 < argc) {
+            tags.staleNameFraction = std::atof(argv[++i]);
+        }
+        else if (arg == "--orphans" && i + 1 < argc) {
+            tags.orphanTags = static_cast<size_t>(std::atoll(argv[++i]));
+        }
+        else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << "\n\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (rootsMagicDbPath.empty()) {
+        std::cerr << "Error: RootsMagic database path is required (-r)\n\n";
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (tags.taggedFraction < 0 || tags.lostFoundFraction < 0 || tags.taggedFraction + tags.lostFoundFraction > 1) {
+        std::cerr << "Error: --tagged and --lost-found must be between 0 and 1 and add up to at most 1\n\n";
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!generateRootsMagicDatabase(rootsMagicDbPath, tree)) {
+        std::cerr << "Failed to generate RootsMagic database" << std::endl;
+        return 1;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Generated " << tree.people << " people in " << rootsMagicDbPath
+              << " (" << elapsed.count() << " ms)" << std::endl;
+
+    if (!digiKamDbPath.empty()) {
+        start = std::chrono::steady_clock::now();
+        if (!generateDigiKamDatabase(digiKamDbPath, rootsMagicDbPath, tags)) {
+            std::cerr << "Failed to generate DigiKam database" << std::endl;
+            return 1;
+        }
+        elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << "Generated DigiKam tags in " << digiKamDbPath << " (" << elapsed.count() << " ms)" << std::endl;
+    }
+    return 0;
+}
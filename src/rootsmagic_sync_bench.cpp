@@ -0,0 +1,286 @@
+// End-to-end benchmark: generates a synthetic RootsMagic tree and DigiKam
+// database, then times RootsMagicSync::synchronizeTags through a first sync,
+// an unchanged re-run, a run after many renames and a run after many deletions.
+#include "logger.h"
+#include "rmnocase.h"
+#include "rootsmagicsync.h"
+#include "syntheticdb.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+struct BenchOptions {
+    SyntheticTreeOptions tree;
+    std::string directory = ".";
+    bool keepFiles = false;
+    bool bulkApply = false;
+    bool incremental = false;
+    bool streaming = false;
+    int memoryLimitMb = 64;
+    ConnectionProfile connectionProfile = ConnectionProfile::Safe;
+    bool ownerIndex = false;
+};
+
+struct ScenarioResult {
+    double setupMs;
+    double connectMs;
+    double syncMs;
+    int tags;
+    int errorLines;
+    bool success;
+    std::array<SyncMetrics::Phase, static_cast<size_t>(SyncPhase::Count)> phases;
+};
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool modifyRootsMagic(const std::string& path, const char* sql)
+{
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "Failed to open " << path << ": " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return false;
+    }
+
+    // Updating indexed name columns needs the collation RootsMagic declares them with
+    registerRmnocaseCollation(db);
+    char* errorMessage = nullptr;
+    bool success = sqlite3_exec(db, sql, nullptr, nullptr, &errorMessage) == SQLITE_OK;
+    if (!success) {
+        std::cerr << "Failed to modify " << path << ": " << (errorMessage ? errorMessage : "unknown") << std::endl;
+        sqlite3_free(errorMessage);
+    }
+    sqlite3_close(db);
+    return success;
+}
+
+int countTags(const std::string& path)
+{
+    sqlite3* db = nullptr;
+    int count = -1;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM Tags", -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW) {
+            count = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return count;
+}
+
+// One sync run as the command line tool would do it, with its console output captured
+void runSync(const BenchOptions& options, const std::string& rootsMagicPath, const std::string& digiKamPath,
+             ScenarioResult& result)
+{
+    std::ostringstream output;
+    std::ostringstream errors;
+    std::streambuf* savedOut = std::cout.rdbuf(output.rdbuf());
+    std::streambuf* savedErr = std::cerr.rdbuf(errors.rdbuf());
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        RootsMagicSync sync;
+        sync.setBulkApply(options.bulkApply);
+        sync.setIncremental(options.incremental);
+        sync.setStreaming(options.streaming, options.memoryLimitMb);
+        sync.setConnectionProfile(options.connectionProfile);
+        sync.setOwnerIndex(options.ownerIndex);
+
+        result.success = sync.connectToRootsMagicDatabase(rootsMagicPath) &&
+                         sync.connectToDigiKamDatabase(digiKamPath);
+        result.connectMs = millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        result.success = result.success && sync.synchronizeTags();
+        result.syncMs = millisecondsSince(start);
+
+        for (size_t i = 0; i < result.phases.size(); i++) {
+            result.phases[i] = sync.metrics().phase(static_cast<SyncPhase>(i));
+        }
+    }
+    Logger::instance().flush();
+
+    std::cout.rdbuf(savedOut);
+    std::cerr.rdbuf(savedErr);
+
+    std::string errorText = errors.str();
+    result.errorLines = 0;
+    for (char c : errorText) {
+        if (c == '\n') result.errorLines++;
+    }
+    result.tags = countTags(digiKamPath);
+}
+
+void printResult(const char* scenario, const ScenarioResult& result)
+{
+    std::cout << std::left << std::setw(16) << scenario << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << result.setupMs
+              << std::setw(12) << result.connectMs
+              << std::setw(12) << result.syncMs
+              << std::setw(10) << result.tags
+              << std::setw(8) << result.errorLines
+              << (result.success ? "" : "  FAILED") << std::endl;
+
+    // Phases that took measurable time, indented under their scenario
+    for (size_t i = 0; i < result.phases.size(); i++) {
+        const SyncMetrics::Phase& phase = result.phases[i];
+        if (phase.milliseconds < 0.05) continue;
+        std::cout << "  " << std::left << std::setw(38) << syncPhaseName(static_cast<SyncPhase>(i)) << std::right
+                  << std::setw(12) << phase.milliseconds << std::setw(10) << phase.rows << std::endl;
+    }
+}
+
+void printUsage(const char* programName)
+{
+    std::cout << "RootsMagic to DigiKam sync benchmark\n"
+              << "Usage: " << programName << " [options]\n"
+              << "Options:\n"
+              << "  -n, --people N       People in the synthetic tree, 1000 to 5000000 (default: 10000)\n"
+              << "      --seed N         Random seed for the generator (default: 1)\n"
+              << "      --dir PATH       Directory for the generated databases (default: .)\n"
+              << "      --keep           Keep the generated databases\n"
+              << "  -b, --bulk           Sync with --bulk\n"
+              << "  -i, --incremental    Sync with --incremental\n"
+              << "      --stream         Sync with --stream\n"
+              << "      --memory-limit-mb N\n"
+              << "                       Memory ceiling for --stream, implies it (default: 64)\n"
+              << "      --profile P      Sync with --profile P: safe, fast or bulk (default: safe)\n"
+              << "      --owner-index    Sync with --owner-index; its warning shows in Errors if unused\n"
+              << "  -h, --help           Show this help message\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-n" || arg == "--people") && i + 1 < argc) {
+            long long people = std::atoll(argv[++i]);
+            if (people <= 0) {
+                std::cerr << "Error: --people must be a positive number\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+            options.tree.people = static_cast<size_t>(people);
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            options.tree.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--dir" && i + 1 < argc) {
+            options.directory = argv[++i];
+        }
+        else if (arg == "--keep") {
+            options.keepFiles = true;
+        }
+        else if (arg == "-b" || arg == "--bulk") {
+            options.bulkApply = true;
+        }
+        else if (arg == "-i" || arg == "--incremental") {
+            options.incremental = true;
+        }
+        else if (arg == "--stream") {
+            options.streaming = true;
+        }
+        else if (arg == "--memory-limit-mb" && i + 1 < argc) {
+            options.memoryLimitMb = std::atoi(argv[++i]);
+            if (options.memoryLimitMb <= 0) {
+                std::cerr << "Error: --memory-limit-mb must be a positive number\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+            options.streaming = true;
+        }
+        else if (arg == "--profile" && i + 1 < argc) {
+            if (!parseConnectionProfile(argv[++i], options.connectionProfile)) {
+                std::cerr << "Error: --profile must be safe, fast or bulk\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--owner-index") {
+            options.ownerIndex = true;
+        }
+        else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << "\n\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::string rootsMagicPath = options.directory + "/bench.rmtree";
+    std::string digiKamPath = options.directory + "/bench-digikam4.db";
+
+    std::cout << "Synthetic tree: " << options.tree.people << " people, seed " << options.tree.seed
+              << ", profile " << connectionProfileName(options.connectionProfile)
+              << (options.ownerIndex ? ", owner index" : "") << "\n";
+    std::cout << std::left << std::setw(16) << "Scenario" << std::right
+              << std::setw(12) << "Setup ms" << std::setw(12) << "Connect ms" << std::setw(12) << "Sync ms"
+              << std::setw(10) << "Tags" << std::setw(8) << "Errors" << std::endl;
+
+    ScenarioResult result = {};
+    bool success = true;
+
+    // First sync into a DigiKam database that has never seen RootsMagic
+    auto start = std::chrono::steady_clock::now();
+    if (!generateRootsMagicDatabase(rootsMagicPath, options.tree) ||
+        !generateDigiKamDatabase(digiKamPath, rootsMagicPath, SyntheticTagOptions())) {
+        std::cerr << "Failed to generate the benchmark databases" << std::endl;
+        return 1;
+    }
+    result.setupMs = millisecondsSince(start);
+    runSync(options, rootsMagicPath, digiKamPath, result);
+    printResult("initial", result);
+    success = success && result.success;
+
+    // Nothing changed since the last run
+    result.setupMs = 0;
+    runSync(options, rootsMagicPath, digiKamPath, result);
+    printResult("no-op", result);
+    success = success && result.success;
+
+    // A quarter of the people renamed
+    start = std::chrono::steady_clock::now();
+    success = modifyRootsMagic(rootsMagicPath,
+        "UPDATE NameTable SET Given = Given || ' Jr', UTCModDate = UTCModDate + 1 "
+        "WHERE IsPrimary = 1 AND OwnerID % 4 = 0;") && success;
+    result.setupMs = millisecondsSince(start);
+    runSync(options, rootsMagicPath, digiKamPath, result);
+    printResult("rename-heavy", result);
+    success = success && result.success;
+
+    // A fifth of the people deleted, leaving their tags to go to Lost & Found
+    start = std::chrono::steady_clock::now();
+    success = modifyRootsMagic(rootsMagicPath,
+        "DELETE FROM NameTable WHERE OwnerID % 5 = 1;"
+        "DELETE FROM ChildTable WHERE ChildID % 5 = 1;"
+        "UPDATE FamilyTable SET UTCModDate = UTCModDate + 2 WHERE FatherID % 5 = 1 OR MotherID % 5 = 1;") && success;
+    result.setupMs = millisecondsSince(start);
+    runSync(options, rootsMagicPath, digiKamPath, result);
+    printResult("orphan-heavy", result);
+    success = success && result.success;
+
+    if (!options.keepFiles) {
+        std::remove(rootsMagicPath.c_str());
+        std::remove(digiKamPath.c_str());
+    }
+    return success ? 0 : 1;
+}
@@ -1,18 +1,43 @@
 #include "rootsmagicsync.h"
+#include "bulktagwriter.h"
+#include "logger.h"
+#include "nameformat.h"
+#include "rmnocase.h"
+#include "statementcache.h"
+#include "stringarena.h"
+#include "syncmetrics.h"
+#include "syncplan.h"
+#include <cstdio>
 #include <iostream>
+#include <limits>
+#include <optional>
 #include <sstream>
 #include <algorithm>
 #include <cctype>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
 
 RootsMagicSync::RootsMagicSync() 
-    : m_rootsMagicDb(nullptr), m_digiKamDb(nullptr), 
-      m_tagsCreated(0), m_tagsUpdated(0), m_tagsOrphaned(0), m_tagsRescued(0)
+    : m_rootsMagicDb(nullptr), m_digiKamDb(nullptr), m_hasTagsTree(false), m_tagIndexVersion(-1),
+      m_bulkApply(false), m_batchSize(1000), m_incremental(false), m_concurrentLoad(true),
+      m_streaming(false), m_streamChunkSize(0),
+      m_connectionProfile(ConnectionProfile::Safe),
+      m_connectionSettings(ConnectionSettings::forProfile(ConnectionProfile::Safe)), m_ownerIndex(false),
+      m_familyTagsRenamed(0), m_familyTagsCollapsed(0)
 {
+    std::string error;
+    m_personFormat.parsePerson(NameFormat::kDefaultPersonFormat, error);
+    m_familyFormat.parseFamily(NameFormat::kDefaultFamilyFormat, error);
 }
 
 RootsMagicSync::~RootsMagicSync()
 {
+    // Cached statements must be finalized before their connections can close
+    m_rootsMagicStatements.reset();
+    m_digiKamStatements.reset();
+
     if (m_rootsMagicDb) {
         sqlite3_close(m_rootsMagicDb);
     }
@@ -21,287 +46,780 @@ RootsMagicSync::~RootsMagicSync()
     }
 }
 
+void RootsMagicSync::setBulkApply(bool enabled, int batchSize)
+{
+    m_bulkApply = enabled;
+    m_batchSize = batchSize > 0 ? batchSize : 1;
+}
+
+void RootsMagicSync::setIncremental(bool enabled)
+{
+    m_incremental = enabled;
+}
+
+void RootsMagicSync::setConcurrentLoad(bool enabled)
+{
+    m_concurrentLoad = enabled;
+}
+
+void RootsMagicSync::setStreaming(bool enabled, size_t memoryLimitMb)
+{
+    // Rough heap cost of one person in a chunk: the record, its tags in both
+    // trees, its family and its share of the plan, with container overhead
+    const size_t bytesPerPerson = 2048;
+    
+    m_streaming = enabled;
+    m_streamChunkSize = std::max<size_t>(256, memoryLimitMb * 1024 * 1024 / bytesPerPerson);
+}
+
+void RootsMagicSync::setConnectionProfile(ConnectionProfile profile)
+{
+    m_connectionProfile = profile;
+    m_connectionSettings = ConnectionSettings::forProfile(profile);
+}
+
+void RootsMagicSync::setOwnerIndex(bool enabled)
+{
+    m_ownerIndex = enabled;
+}
+
+bool RootsMagicSync::setNameFormats(const std::string& personFormat, const std::string& familyFormat)
+{
+    NameFormat person;
+    NameFormat family;
+    std::string error;
+    
+    if (!person.parsePerson(personFormat, error)) {
+        logError() << "Invalid person name format \"" << personFormat << "\": " << error << std::endl;
+        return false;
+    }
+    if (!family.parseFamily(familyFormat, error)) {
+        logError() << "Invalid family name format \"" << familyFormat << "\": " << error << std::endl;
+        return false;
+    }
+    
+    // Tag names must be unique under their parent, so formats without {id} can collide
+    if (!person.includesId()) {
+        logWarning() << "Warning: person name format has no {id}; people with the same name and years will clash" << std::endl;
+    }
+    if (!family.includesId()) {
+        logWarning() << "Warning: family name format has no {id}; families with the same parents will clash" << std::endl;
+    }
+    
+    m_personFormat = std::move(person);
+    m_familyFormat = std::move(family);
+    return true;
+}
+
 bool RootsMagicSync::connectToRootsMagicDatabase(const std::string& rmDbPath)
 {
-    int rc = sqlite3_open_v2(rmDbPath.c_str(), &m_rootsMagicDb, SQLITE_OPEN_READONLY, nullptr);
-    if (rc) {
-        std::cerr << "Failed to connect to RootsMagic database: " << sqlite3_errmsg(m_rootsMagicDb) << std::endl;
+    closeRootsMagicDatabase();
+    m_rootsMagicDb = openRootsMagicReader(rmDbPath, m_connectionSettings);
+    if (!m_rootsMagicDb) {
         return false;
     }
     
-    // Register a dummy RMNOCASE collation to handle RootsMagic-specific collation
-    rc = sqlite3_create_collation(m_rootsMagicDb, "RMNOCASE", SQLITE_UTF8, nullptr, 
-                                 [](void*, int len1, const void* data1, int len2, const void* data2) -> int {
-                                     // Simple case-insensitive comparison
-                                     std::string s1((const char*)data1, len1);
-                                     std::string s2((const char*)data2, len2);
-                                     std::transform(s1.begin(), s1.end(), s1.begin(), ::tolower);
-                                     std::transform(s2.begin(), s2.end(), s2.begin(), ::tolower);
-                                     return s1.compare(s2);
-                                 });
+    m_rootsMagicPath = rmDbPath;
+    m_rootsMagicStatements = std::make_unique<StatementCache>(m_rootsMagicDb);
+    m_metrics.attach(m_rootsMagicDb);
+
+    logInfo() << "Connected to RootsMagic database: " << rmDbPath << std::endl;
+    return true;
+}
+
+void RootsMagicSync::closeRootsMagicDatabase()
+{
+    if (!m_rootsMagicDb) {
+        return;
+    }
+    
+    m_rootsMagicStatements.reset();
+    m_metrics.detach(m_rootsMagicDb);
+    sqlite3_close(m_rootsMagicDb);
+    m_rootsMagicDb = nullptr;
+    m_rootsMagicPath.clear();
+}
+
+sqlite3* RootsMagicSync::openRootsMagicReader(const std::string& rmDbPath, const ConnectionSettings& settings)
+{
+    sqlite3* db = nullptr;
+    int rc = openReadConnection(rmDbPath, settings, &db);
+    if (rc) {
+        logError() << "Failed to connect to RootsMagic database: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return nullptr;
+    }
+    
+    // RootsMagic declares its name columns with its own RMNOCASE collation
+    rc = registerRmnocaseCollation(db);
     
     if (rc != SQLITE_OK) {
-        std::cerr << "Warning: Failed to register RMNOCASE collation: " << sqlite3_errmsg(m_rootsMagicDb) << std::endl;
+        logWarning() << "Warning: Failed to register RMNOCASE collation: " << sqlite3_errmsg(db) << std::endl;
     }
     
-    std::cout << "Connected to RootsMagic database: " << rmDbPath << std::endl;
-    return true;
+    return db;
 }
 
 bool RootsMagicSync::connectToDigiKamDatabase(const std::string& dkDbPath)
 {
     int rc = sqlite3_open(dkDbPath.c_str(), &m_digiKamDb);
     if (rc) {
-        std::cerr << "Failed to connect to DigiKam database: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+        logError() << "Failed to connect to DigiKam database: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
         return false;
     }
     
-    std::cout << "Connected to DigiKam database: " << dkDbPath << std::endl;
+    m_digiKamStatements = std::make_unique<StatementCache>(m_digiKamDb);
+    m_metrics.attach(m_digiKamDb);
+
+    {
+        CachedStatement stmt(*m_digiKamStatements,
+                             "SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = 'TagsTree'");
+        m_hasTagsTree = stmt && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0;
+    }
+
+    logInfo() << "Connected to DigiKam database: " << dkDbPath << std::endl;
     return true;
 }
 
+void RootsMagicSync::setLogCallback(Logger::Sink sink)
+{
+    Logger::instance().setSink(std::move(sink));
+}
+
+void RootsMagicSync::setProgressCallback(Logger::ProgressCallback callback)
+{
+    Logger::instance().setProgressCallback(std::move(callback));
+}
+
 bool RootsMagicSync::synchronizeTags(const std::string& parentTagName, const std::string& lostFoundTagName)
 {
     if (!m_rootsMagicDb || !m_digiKamDb) {
-        std::cerr << "Both databases must be connected before synchronization" << std::endl;
+        logError() << "Both databases must be connected before synchronization" << std::endl;
+        m_report = SyncReport();
+        return false;
+    }
+
+    m_metrics.start();
+    m_report.trees.assign(1, SyncTreeResult(m_rootsMagicPath, parentTagName));
+    dropStaleTagIndex();
+    
+    bool success;
+    {
+        // Writer settings last for the transaction only; the previous ones come back after it
+        ConnectionTuning tuning(m_digiKamDb, m_connectionSettings);
+        m_metrics.setConnectionProfile(connectionProfileName(m_connectionProfile), tuning.journalMode());
+        if (m_ownerIndex) {
+            ensureOwnerIndex();
+        }
+        success = runSynchronization(parentTagName, lostFoundTagName, m_report.trees.front(), false);
+    }
+    m_tagIndexVersion = m_tagIndex.isLoaded() ? digiKamDataVersion() : -1;
+
+    finishReport(success);
+    return success;
+}
+
+SyncReport RootsMagicSync::synchronize(const std::string& parentTagName, const std::string& lostFoundTagName)
+{
+    synchronizeTags(parentTagName, lostFoundTagName);
+    return m_report;
+}
+
+bool RootsMagicSync::synchronizeBatch(const std::vector<SyncJob>& jobs, const std::string& lostFoundTagName)
+{
+    if (!m_digiKamDb) {
+        logError() << "The DigiKam database must be connected before synchronization" << std::endl;
+        m_report = SyncReport();
         return false;
     }
 
-    std::cout << "Starting RootsMagic to DigiKam tag synchronization..." << std::endl;
+    m_metrics.start();
+    m_report.trees.clear();
+    dropStaleTagIndex();
+
+    bool success = true;
+    {
+        ConnectionTuning tuning(m_digiKamDb, m_connectionSettings);
+        m_metrics.setConnectionProfile(connectionProfileName(m_connectionProfile), tuning.journalMode());
+        if (m_ownerIndex) {
+            ensureOwnerIndex();
+        }
+
+        // The trees share one transaction, and with it one tag index; each is a savepoint inside it
+        if (!executeQuery(m_digiKamDb, "BEGIN TRANSACTION;")) {
+            success = false;
+        } else {
+            for (const SyncJob& job : jobs) {
+                logInfo() << "\n=== " << job.rootsMagicPath << " -> " << job.parentTagName << " ===" << std::endl;
+                m_report.trees.emplace_back(job.rootsMagicPath, job.parentTagName);
+                if (!connectToRootsMagicDatabase(job.rootsMagicPath) ||
+                    !runSynchronization(job.parentTagName, lostFoundTagName, m_report.trees.back(), true)) {
+                    logError() << "Synchronization of " << job.rootsMagicPath << " failed, its changes were rolled back" << std::endl;
+                    success = false;
+                }
+            }
+            closeRootsMagicDatabase();
+
+            PhaseTimer timer(m_metrics, SyncPhase::Commit);
+            if (!executeQuery(m_digiKamDb, "COMMIT;")) {
+                executeQuery(m_digiKamDb, "ROLLBACK;");
+                m_tagIndex.clear();
+                for (SyncTreeResult& result : m_report.trees) {
+                    result.success = false;
+                }
+                success = false;
+            }
+        }
+    }
+    m_tagIndexVersion = m_tagIndex.isLoaded() ? digiKamDataVersion() : -1;
+
+    // Combined report
+    int treesSynchronized = 0;
+    logInfo() << "\nBatch Summary:" << std::endl;
+    for (const SyncTreeResult& result : m_report.trees) {
+        if (!result.success) {
+            logInfo() << "  " << result.parentTagName << " (" << result.rootsMagicPath << "): failed, no changes kept" << std::endl;
+            continue;
+        }
+        treesSynchronized++;
+        logInfo() << "  " << result.parentTagName << " (" << result.rootsMagicPath << "): "
+                  << result.people << " people, " << result.tagsCreated << " created, "
+                  << result.tagsRescued << " rescued, " << result.tagsUpdated << " updated, "
+                  << result.tagsOrphaned << " moved to Lost & Found, "
+                  << result.rootsMagicTags << " tags in tree" << std::endl;
+    }
+    logInfo() << "  Trees synchronized: " << treesSynchronized << " of " << jobs.size() << std::endl;
+
+    // Trees that failed were rolled back, so the last one that succeeded saw the final Lost & Found
+    for (auto it = m_report.trees.rbegin(); it != m_report.trees.rend(); ++it) {
+        if (it->success) {
+            logInfo() << "  Tags in DigiKam Lost & Found tree: " << it->lostFoundTags << std::endl;
+            break;
+        }
+    }
+
+    finishReport(success);
+    return success;
+}
+
+void RootsMagicSync::finishReport(bool success)
+{
+    m_report.success = success;
+    m_report.people = 0;
+    m_report.tagsCreated = m_report.tagsUpdated = m_report.tagsOrphaned = m_report.tagsRescued = 0;
+    m_report.familyTagsRenamed = m_report.familyTagsCollapsed = 0;
+    for (const SyncTreeResult& result : m_report.trees) {
+        if (result.success) {
+            m_report.people += result.people;
+            m_report.tagsCreated += result.tagsCreated;
+            m_report.tagsUpdated += result.tagsUpdated;
+            m_report.tagsOrphaned += result.tagsOrphaned;
+            m_report.tagsRescued += result.tagsRescued;
+            m_report.familyTagsRenamed += result.familyTagsRenamed;
+            m_report.familyTagsCollapsed += result.familyTagsCollapsed;
+        }
+    }
+
+    m_metrics.setPeople(static_cast<long long>(m_report.people));
+    m_metrics.setTagCounts(m_report.tagsCreated, m_report.tagsUpdated, m_report.tagsOrphaned, m_report.tagsRescued);
+    m_metrics.finish(success);
+
+    m_report.mode = m_metrics.mode();
+    m_report.totalMilliseconds = m_metrics.totalMilliseconds();
+    m_report.statementsExecuted = m_metrics.statementsExecuted();
+    m_report.rowsWritten = m_metrics.rowsWritten();
+    m_report.phases.clear();
+    for (size_t i = 0; i < static_cast<size_t>(SyncPhase::Count); i++) {
+        SyncPhase phase = static_cast<SyncPhase>(i);
+        m_report.phases.push_back({syncPhaseName(phase), m_metrics.phase(phase).milliseconds, m_metrics.phase(phase).rows});
+    }
+    Logger::instance().flush();
+}
+
+bool RootsMagicSync::runSynchronization(const std::string& parentTagName, const std::string& lostFoundTagName,
+                                        SyncTreeResult& result, bool nested)
+{
+    logInfo() << "Starting RootsMagic to DigiKam tag synchronization..." << std::endl;
+    m_strings.clear();
+    m_createdOwnerIds.clear();
+    m_renamedOwnerIds.clear();
+    m_orphanedOwnerIds.clear();
+    m_rescuedOwnerIds.clear();
+    m_familyTagsRenamed = 0;
+    m_familyTagsCollapsed = 0;
 
     // Phase 1: Load data and perform migrations outside of transaction
-    std::cout << "Loading RootsMagic people..." << std::endl;
-    auto rmPeople = loadRootsMagicPeople();
-    std::cout << "Found " << rmPeople.size() << " people in RootsMagic" << std::endl;
+    std::vector<PersonRecord> rmPeople;
+    IdTable<FamilyRecord> families;
+    IdTable<DigiKamTag> existingTags;
+    IdTable<DigiKamTag> lostFoundTags;
+    IdSet liveOwnerIds;
+
+    // The newest RootsMagic modification date is recorded on the parent tag after each sync
+    double changeMark = hasModificationDates() ? loadRootsMagicChangeMark() : -1.0;
+    int markedParentTagId = 0;
+    double previousMark = changeMark >= 0 ? readSyncMark(parentTagName, markedParentTagId) : -1.0;
+    bool incremental = m_incremental && previousMark >= 0 && previousMark <= changeMark;
+    if (m_streaming) {
+        incremental = false;
+    } else if (m_incremental && !incremental) {
+        logInfo() << "No usable sync mark for this RootsMagic file, running a full sync" << std::endl;
+    }
+    m_metrics.setMode(m_streaming ? "streaming" : incremental ? "incremental" : "full", m_bulkApply);
 
-    std::cout << "Loading family data..." << std::endl;
-    auto families = loadFamilyData();
-    std::cout << "Found " << families.size() << " families in RootsMagic" << std::endl;
+    if (m_streaming) {
+        logInfo() << "Streaming RootsMagic people in chunks of " << m_streamChunkSize << "..." << std::endl;
+    } else if (incremental) {
+        if (!loadDigiKamTrees(parentTagName, lostFoundTagName, existingTags, lostFoundTags, m_strings, logInfo())) {
+            return false;
+        }
 
-    std::cout << "Loading existing DigiKam tags..." << std::endl;
-    auto existingTags = loadExistingDigiKamTags(parentTagName);
-    std::cout << "Found " << existingTags.size() << " existing RootsMagic tags in DigiKam" << std::endl;
+        logInfo() << "Loading RootsMagic people changed since last sync..." << std::endl;
+        if (!loadChangedRootsMagicData(previousMark, markedParentTagId, existingTags, lostFoundTags, rmPeople, families, liveOwnerIds)) {
+            return false;
+        }
+        logInfo() << "Found " << rmPeople.size() << " changed people in " << families.size() << " families ("
+                  << liveOwnerIds.size() << " people in RootsMagic)" << std::endl;
+    } else if (m_concurrentLoad && canLoadConcurrently()) {
+        if (!loadConcurrently(parentTagName, lostFoundTagName, rmPeople, families, existingTags, lostFoundTags)) {
+            return false;
+        }
+    } else {
+        if (!loadDigiKamTrees(parentTagName, lostFoundTagName, existingTags, lostFoundTags, m_strings, logInfo())) {
+            return false;
+        }
+        rmPeople = loadRootsMagicPeople(m_rootsMagicDb, *m_rootsMagicStatements, m_strings, logInfo());
+        families = loadFamilyData(m_rootsMagicDb, *m_rootsMagicStatements, m_strings, logInfo());
+    }
 
-    // Begin transaction
-    if (!executeQuery(m_digiKamDb, "BEGIN TRANSACTION;")) {
+    // Begin transaction, or this tree's part of the batch's one
+    if (!executeQuery(m_digiKamDb, nested ? "SAVEPOINT rootsmagic_tree;" : "BEGIN TRANSACTION;")) {
         return false;
     }
 
     try {
-        std::cout << "Loading tags from Lost & Found..." << std::endl;
-        auto lostFoundTags = loadExistingDigiKamTags(lostFoundTagName);
-        std::cout << "Found " << lostFoundTags.size() << " tags in Lost & Found" << std::endl;
-        
-        // Check for duplicates across both trees and clean them up
-        std::vector<int> duplicateTagsToRemove;
-        for (const auto& [ownerId, lostTag] : lostFoundTags) {
-            if (existingTags.find(ownerId) != existingTags.end()) {
-                // This ownerId exists in both trees - mark Lost & Found version for removal
-                duplicateTagsToRemove.push_back(lostTag.tagId);
-                std::cout << "Found duplicate tag in both trees: " << lostTag.name << " (OwnerID: " << ownerId << ")" << std::endl;
-            }
-        }
-        
-        if (!duplicateTagsToRemove.empty()) {
-            std::cout << "Removing " << duplicateTagsToRemove.size() << " duplicate tags from Lost & Found..." << std::endl;
-            if (removeDuplicateTags(duplicateTagsToRemove)) {
-                // Reload Lost & Found tags after cleanup
-                lostFoundTags = loadExistingDigiKamTags(lostFoundTagName);
-                std::cout << "After cleanup: Found " << lostFoundTags.size() << " tags in Lost & Found" << std::endl;
+        // Streaming reads its tags chunk by chunk and only needs the index for writing
+        if (!m_tagIndex.isLoaded()) {
+            logInfo() << "Indexing DigiKam tag tree..." << std::endl;
+            PhaseTimer timer(m_metrics, SyncPhase::DigiKamLoad);
+            if (!m_tagIndex.load(m_digiKamDb, *m_digiKamStatements)) {
+                throw std::runtime_error("Failed to index DigiKam tags");
             }
+            timer.setRows(static_cast<long long>(m_tagIndex.size()));
+            logInfo() << "Indexed " << m_tagIndex.size() << " DigiKam tags" << std::endl;
         }
 
         // Ensure parent tags exist
-        if (!ensureParentTagExists(parentTagName)) {
+        int parentTagId = 0;
+        int lostFoundTagId = 0;
+        if (!ensureParentTagExists(parentTagName, parentTagId)) {
             throw std::runtime_error("Failed to create parent tag: " + parentTagName);
         }
-        if (!ensureParentTagExists(lostFoundTagName)) {
+        if (!ensureParentTagExists(lostFoundTagName, lostFoundTagId)) {
             throw std::runtime_error("Failed to create Lost & Found tag: " + lostFoundTagName);
         }
 
-        // Phase 3: Synchronize
-        std::cout << "Synchronizing tags..." << std::endl;
-        
-        // First, handle family-based parenting for existing tags
-        std::cout << "Checking for existing tags that need family parenting..." << std::endl;
-        for (const auto& person : rmPeople) {
-            if (person.familyId > 0) {
-                auto familyIt = families.find(person.familyId);
-                if (familyIt != families.end()) {
-                    const FamilyRecord& family = familyIt->second;
-                    
-                    // Create the family tag if it doesn't exist
-                    if (!createFamilyTag(family, parentTagName)) {
-                        std::cerr << "Failed to create family tag for: " << family.familyTagName << std::endl;
-                        continue;
-                    }
-                    
-                    // Check if this person's tag exists and needs to be moved to the family
-                    auto existingTagIt = existingTags.find(person.ownerId);
-                    if (existingTagIt != existingTags.end()) {
-                        // Check if the tag is currently under the RootsMagic parent
-                        std::string checkParentSql = R"(
-                            SELECT t.pid FROM Tags t 
-                            WHERE t.id = ? AND t.pid = (SELECT id FROM Tags WHERE name = ?)
-                        )";
-                        
-                        sqlite3_stmt* stmt;
-                        int rc = sqlite3_prepare_v2(m_digiKamDb, checkParentSql.c_str(), -1, &stmt, nullptr);
-                        if (rc == SQLITE_OK) {
-                            sqlite3_bind_int(stmt, 1, existingTagIt->second.tagId);
-                            sqlite3_bind_text(stmt, 2, parentTagName.c_str(), -1, SQLITE_STATIC);
-                            
-                            if (sqlite3_step(stmt) == SQLITE_ROW) {
-                                // Tag is under RootsMagic parent, move it to family parent
-                                std::string updateParentSql = R"(
-                                    UPDATE Tags SET pid = (SELECT id FROM Tags WHERE name = ?) 
-                                    WHERE id = ?
-                                )";
-                                
-                                sqlite3_stmt* updateStmt;
-                                int updateRc = sqlite3_prepare_v2(m_digiKamDb, updateParentSql.c_str(), -1, &updateStmt, nullptr);
-                                if (updateRc == SQLITE_OK) {
-                                    sqlite3_bind_text(updateStmt, 1, family.familyTagName.c_str(), -1, SQLITE_STATIC);
-                                    sqlite3_bind_int(updateStmt, 2, existingTagIt->second.tagId);
-                                    
-                                    if (sqlite3_step(updateStmt) == SQLITE_DONE) {
-                                        std::cout << "Moved '" << person.formattedName << "' to family '" << family.familyTagName << "'" << std::endl;
-                                    }
-                                    sqlite3_finalize(updateStmt);
-                                }
-                            }
-                            sqlite3_finalize(stmt);
-                        }
-                    }
-                }
+        size_t peopleSynchronized = rmPeople.size();
+        if (m_streaming) {
+            // Phases 2 and 3 run once per chunk
+            peopleSynchronized = streamSynchronize(parentTagName, lostFoundTagName, parentTagId, lostFoundTagId);
+        } else {
+            // Phase 2: Work out every change in memory
+            logInfo() << "Planning synchronization..." << std::endl;
+            SyncPlan plan;
+            long long planMs;
+            {
+                PhaseTimer timer(m_metrics, SyncPhase::Planning);
+                plan = buildSyncPlan(rmPeople, families, existingTags, lostFoundTags,
+                                     incremental ? &liveOwnerIds : nullptr);
+                timer.setRows(static_cast<long long>(plan.changeCount()));
+                planMs = static_cast<long long>(timer.elapsedMilliseconds());
             }
+            logInfo() << "Planned " << plan.changeCount() << " changes in " << planMs << " ms: "
+                      << plan.creates.size() << " new, " << plan.rescues.size() << " to rescue, "
+                      << plan.renames.size() << " renamed, "
+                      << plan.orphanMoves.size() << " orphaned, " << plan.duplicateDeletes.size() << " duplicates" << std::endl;
+
+            // Phase 3: Synchronize
+            applySyncPlan(plan, parentTagId, lostFoundTagId);
         }
-        
-        // Track which existing tags are still valid
-        std::vector<int> validTagIds;
-        int newPeopleCount = 0;
-        
-        std::cout << "Synchronizing " << rmPeople.size() << " people..." << std::endl;
-        int syncProgress = 0;
-        int lastSyncProgressPercent = 0;
-        
-        for (const auto& person : rmPeople) {
-            auto it = existingTags.find(person.ownerId);
-            if (it != existingTags.end()) {
-                // Tag exists - check if name needs updating
-                validTagIds.push_back(it->second.tagId);
-                if (it->second.name != person.formattedName) {
-                    if (updatePersonTag(it->second.tagId, person)) {
-                        m_tagsUpdated++;
-                        std::cout << "Updated: '" << it->second.name << "' -> '" << person.formattedName << "' (OwnerID: " << person.ownerId << ")" << std::endl;
-                    }
-                }
-            } else {
-                // New person - create tag
-                newPeopleCount++;
-                if (createPersonTag(person, parentTagName, families)) {
-                    m_tagsCreated++;
-                    std::cout << "Created: " << person.formattedName << " (OwnerID: " << person.ownerId << ")" << std::endl;
-                } else {
-                    // Try to rescue from Lost & Found
-                    if (rescueTagFromLostFound(person, parentTagName, lostFoundTags)) {
-                        m_tagsRescued++;
-                        std::cout << "Rescued: " << person.formattedName << " (OwnerID: " << person.ownerId << ")" << std::endl;
-                    } else {
-                        std::cerr << "Failed to create or rescue tag for: " << person.formattedName << " (OwnerID: " << person.ownerId << ")" << std::endl;
-                    }
-                }
+
+        if (changeMark >= 0 && changeMark != previousMark && !writeSyncMark(parentTagId, changeMark)) {
+            throw std::runtime_error("Failed to record sync mark");
+        }
+
+        // Commit transaction; a batch commits once all of its trees are done
+        if (nested) {
+            if (!executeQuery(m_digiKamDb, "RELEASE rootsmagic_tree;")) {
+                throw std::runtime_error("Failed to release savepoint");
             }
-            
-            // Progress tracking for synchronization
-            syncProgress++;
-            int currentSyncProgressPercent = (syncProgress * 100) / rmPeople.size();
-            if (currentSyncProgressPercent > lastSyncProgressPercent) {
-                std::cout << "Sync Progress: " << currentSyncProgressPercent << "% (" << syncProgress << "/" << rmPeople.size() << " people)" << std::endl;
-                lastSyncProgressPercent = currentSyncProgressPercent;
+        } else {
+            PhaseTimer timer(m_metrics, SyncPhase::Commit);
+            if (!executeQuery(m_digiKamDb, "COMMIT;")) {
+                throw std::runtime_error("Failed to commit transaction");
             }
         }
-        
-        // Post-rescue cleanup: Check for any new duplicates created by rescue operations
-        if (m_tagsRescued > 0) {
-            std::cout << "Checking for duplicates after rescue operations..." << std::endl;
-            
-            // Reload both tag trees to get current state
-            auto updatedExistingTags = loadExistingDigiKamTags(parentTagName);
-            auto updatedLostFoundTags = loadExistingDigiKamTags(lostFoundTagName);
-            
-            // Find any duplicates that now exist in both trees
-            std::vector<int> postRescueDuplicates;
-            for (const auto& [ownerId, lostTag] : updatedLostFoundTags) {
-                if (updatedExistingTags.find(ownerId) != updatedExistingTags.end()) {
-                    // This ownerId exists in both trees after rescue - remove from Lost & Found
-                    postRescueDuplicates.push_back(lostTag.tagId);
-                    std::cout << "Found post-rescue duplicate: " << lostTag.name << " (OwnerID: " << ownerId << ")" << std::endl;
-                }
+
+        // The index mirrors every write, so the final counts need no query
+        result.success = true;
+        result.people = peopleSynchronized;
+        result.tagsCreated = static_cast<int>(m_createdOwnerIds.size());
+        result.tagsUpdated = static_cast<int>(m_renamedOwnerIds.size());
+        result.tagsOrphaned = static_cast<int>(m_orphanedOwnerIds.size());
+        result.tagsRescued = static_cast<int>(m_rescuedOwnerIds.size());
+        result.familyTagsRenamed = m_familyTagsRenamed;
+        result.familyTagsCollapsed = m_familyTagsCollapsed;
+        for (std::vector<int>* ownerIds : {&m_createdOwnerIds, &m_renamedOwnerIds, &m_orphanedOwnerIds, &m_rescuedOwnerIds}) {
+            std::sort(ownerIds->begin(), ownerIds->end());
+        }
+        result.createdOwnerIds = m_createdOwnerIds;
+        result.renamedOwnerIds = m_renamedOwnerIds;
+        result.orphanedOwnerIds = m_orphanedOwnerIds;
+        result.rescuedOwnerIds = m_rescuedOwnerIds;
+        result.rootsMagicTags = m_tagIndex.countOwnersUnder(parentTagId);
+        result.lostFoundTags = m_tagIndex.countOwnersUnder(lostFoundTagId);
+
+        // Print summary
+        logInfo() << "\nSynchronization completed successfully:" << std::endl;
+        logInfo() << "  Tags created: " << result.tagsCreated << std::endl;
+        logInfo() << "  Tags rescued from Lost & Found: " << result.tagsRescued << std::endl;
+        logInfo() << "  Tags updated: " << result.tagsUpdated << std::endl;
+        logInfo() << "  Tags moved to Lost & Found: " << result.tagsOrphaned << std::endl;
+        logInfo() << "  Family tags renamed: " << result.familyTagsRenamed << std::endl;
+        logInfo() << "  Stale family tags collapsed: " << result.familyTagsCollapsed << std::endl;
+        logInfo() << "  SQL statements compiled: "
+                  << m_rootsMagicStatements->preparedCount() + m_digiKamStatements->preparedCount()
+                  << " (executed " << m_rootsMagicStatements->totalHits() + m_digiKamStatements->totalHits()
+                  << " times)" << std::endl;
+        logInfo() << "\nFinal Summary:" << std::endl;
+        logInfo() << "  Names synchronized from RootsMagic: " << peopleSynchronized << std::endl;
+        logInfo() << "  Tags in DigiKam RootsMagic tree: " << result.rootsMagicTags << std::endl;
+        logInfo() << "  Tags in DigiKam Lost & Found tree: " << result.lostFoundTags << std::endl;
+
+        return true;
+
+    } catch (const std::exception& e) {
+        logError() << "Error during synchronization: " << e.what() << std::endl;
+        if (nested) {
+            executeQuery(m_digiKamDb, "ROLLBACK TO rootsmagic_tree;");
+            executeQuery(m_digiKamDb, "RELEASE rootsmagic_tree;");
+        } else {
+            executeQuery(m_digiKamDb, "ROLLBACK;");
+        }
+        // The index mirrors writes that were just rolled back
+        m_tagIndex.clear();
+        return false;
+    }
+}
+
+void RootsMagicSync::applySyncPlan(const SyncPlan& plan, int parentTagId, int lostFoundTagId)
+{
+    // Clean up tags that exist in both trees
+    if (!plan.duplicateDeletes.empty()) {
+        PhaseTimer timer(m_metrics, SyncPhase::DuplicateCleanup, true);
+        std::vector<int> duplicateTagIds;
+        for (const DigiKamTag* lostTag : plan.duplicateDeletes) {
+            duplicateTagIds.push_back(lostTag->tagId);
+            logDebug() << "Found duplicate tag in both trees: " << lostTag->name << " (OwnerID: " << lostTag->ownerId << ")" << std::endl;
+        }
+        logInfo() << "Removing " << duplicateTagIds.size() << " duplicate tags from Lost & Found..." << std::endl;
+        if (!removeDuplicateTags(duplicateTagIds)) {
+            throw std::runtime_error("Failed to remove duplicate tags");
+        }
+    }
+
+    // Family tags first, so people can be placed under them
+    IdTable<int> familyTagIds = materializeFamilyTags(plan.familyTags, plan.familyRefreshes, parentTagId);
+
+    logInfo() << "Checking for existing tags that need family parenting..." << std::endl;
+    std::optional<PhaseTimer> phaseTimer;
+    phaseTimer.emplace(m_metrics, SyncPhase::FamilyParenting, true);
+
+    // Tags directly under the parent tag or under another family's tag move to
+    // their own family's; tags placed anywhere else were put there by hand
+    std::vector<std::pair<int, int>> familyMoves;  // Tag, family tag
+    std::unordered_set<std::string> movedNames;    // "family tag id/name" of tags moving in
+    for (const auto& reparent : plan.reparents) {
+        const int* familyTagId = familyTagIds.find(reparent.family->familyId);
+        const TagIndexEntry* entry = m_tagIndex.findById(reparent.tag->tagId);
+        if (!familyTagId || !entry || entry->pid == *familyTagId) continue;
+
+        const TagIndexEntry* currentParent = m_tagIndex.findById(entry->pid);
+        if (entry->pid != parentTagId &&
+            !(currentParent && currentParent->familyId != 0 && currentParent->pid == parentTagId)) {
+            continue;
+        }
+
+        // One name clash would fail the whole batch
+        std::string movedName = std::to_string(*familyTagId) + "/" + entry->name;
+        if (m_tagIndex.findChild(*familyTagId, entry->name) != 0 || !movedNames.insert(movedName).second) {
+            logWarning() << "Warning: Cannot move '" << entry->name << "' to family '" << reparent.family->familyTagName
+                         << "', it already holds a tag of that name" << std::endl;
+            continue;
+        }
+        logDebug() << "Moving '" << entry->name << "' to family '" << reparent.family->familyTagName << "'" << std::endl;
+        familyMoves.emplace_back(entry->id, *familyTagId);
+    }
+    if (!familyMoves.empty()) {
+        logInfo() << "Moving " << familyMoves.size() << " tags under their family tags..." << std::endl;
+        if (!moveTags(familyMoves)) {
+            throw std::runtime_error("Failed to move tags under their family tags");
+        }
+    }
+
+    phaseTimer.emplace(m_metrics, SyncPhase::PersonSync, true);
+    size_t personChanges = plan.renames.size() + plan.creates.size() + plan.rescues.size();
+    logInfo() << "Synchronizing " << personChanges << " changed people..." << std::endl;
+    ProgressReporter syncProgress(logInfo(), "Sync Progress", "people", personChanges);
+
+    for (const auto& rename : plan.renames) {
+        if (updatePersonTag(rename.tag->tagId, *rename.person)) {
+            m_renamedOwnerIds.push_back(rename.person->ownerId);
+            logDebug() << "Updated: '" << rename.tag->name << "' -> '" << rename.person->formattedName << "' (OwnerID: " << rename.person->ownerId << ")" << std::endl;
+        }
+        syncProgress.advance();
+    }
+
+    BulkTagWriter bulkWriter(m_digiKamDb, *m_digiKamStatements, m_tagIndex);
+    std::vector<const PersonRecord*> stagedPeople;
+    if (m_bulkApply && !plan.creates.empty() && !bulkWriter.begin()) {
+        throw std::runtime_error("Failed to set up bulk tag staging");
+    }
+
+    // Writes the staged batch and reports who made it in
+    auto flushStaged = [&]() {
+        if (!bulkWriter.flush()) {
+            throw std::runtime_error("Failed to write staged tags");
+        }
+        for (const PersonRecord* person : stagedPeople) {
+            if (bulkWriter.createdTagId(person->ownerId) != 0) {
+                m_createdOwnerIds.push_back(person->ownerId);
+                logDebug() << "Created: " << person->formattedName << " (OwnerID: " << person->ownerId << ")" << std::endl;
+            } else {
+                logError() << "Failed to create tag for: " << person->formattedName << " (OwnerID: " << person->ownerId << ")" << std::endl;
             }
-            
-            if (!postRescueDuplicates.empty()) {
-                std::cout << "Removing " << postRescueDuplicates.size() << " post-rescue duplicates from Lost & Found..." << std::endl;
-                if (removeDuplicateTags(postRescueDuplicates)) {
-                    // Update our local copy of Lost & Found tags
-                    lostFoundTags = loadExistingDigiKamTags(lostFoundTagName);
-                    std::cout << "Post-rescue cleanup completed successfully" << std::endl;
+        }
+        stagedPeople.clear();
+    };
+
+    for (const PersonRecord* person : plan.creates) {
+        // People with a family go under the family tag, everyone else under the parent tag
+        int tagParentId = parentTagId;
+        const int* familyTagId = familyTagIds.find(person->familyId);
+        if (person->familyId > 0 && familyTagId) {
+            tagParentId = *familyTagId;
+        }
+
+        if (m_bulkApply) {
+            if (bulkWriter.stagePersonTag(person->ownerId, tagParentId, person->formattedName)) {
+                stagedPeople.push_back(person);
+                if (bulkWriter.stagedCount() >= m_batchSize) {
+                    flushStaged();
                 }
+            } else {
+                logError() << "Failed to create tag for: " << person->formattedName << " (OwnerID: " << person->ownerId << ")" << std::endl;
             }
+        } else if (createPersonTag(*person, tagParentId)) {
+            m_createdOwnerIds.push_back(person->ownerId);
+            logDebug() << "Created: " << person->formattedName << " (OwnerID: " << person->ownerId << ")" << std::endl;
+        } else {
+            logError() << "Failed to create tag for: " << person->formattedName << " (OwnerID: " << person->ownerId << ")" << std::endl;
         }
-        
-        std::cout << "Found " << newPeopleCount << " new people to process" << std::endl;
-        std::cout << "DEBUG: existingTags.size() = " << existingTags.size() << std::endl;
-
-        // Phase 4: Handle orphaned tags
-        std::vector<int> orphanedTagIds;
-        for (const auto& [ownerId, tag] : existingTags) {
-            if (std::find(validTagIds.begin(), validTagIds.end(), tag.tagId) == validTagIds.end()) {
-                orphanedTagIds.push_back(tag.tagId);
-            }
+        syncProgress.advance();
+    }
+    if (m_bulkApply) {
+        flushStaged();
+    }
+
+    std::vector<int> postRescueDuplicates;
+    for (const auto& rescue : plan.rescues) {
+        // Rescued tags go straight under their family tag, like new ones, so the next run has nothing to move
+        int tagParentId = parentTagId;
+        const int* familyTagId = familyTagIds.find(rescue.person->familyId);
+        if (rescue.person->familyId > 0 && familyTagId && m_tagIndex.findChild(*familyTagId, rescue.tag->name) == 0) {
+            tagParentId = *familyTagId;
         }
 
-        if (!orphanedTagIds.empty()) {
-            std::cout << "Moving " << orphanedTagIds.size() << " orphaned tags to Lost & Found..." << std::endl;
-            if (moveOrphanedTagsToLostFound(orphanedTagIds, lostFoundTagName, existingTags)) {
-                m_tagsOrphaned = orphanedTagIds.size();
+        if (rescueTagFromLostFound(*rescue.tag, *rescue.person, tagParentId)) {
+            m_rescuedOwnerIds.push_back(rescue.person->ownerId);
+            logDebug() << "Rescued: " << rescue.person->formattedName << " (OwnerID: " << rescue.person->ownerId << ")" << std::endl;
+
+            // Any other copy of this person still in Lost & Found is now a duplicate
+            for (int tagId : m_tagIndex.tagsForOwner(rescue.person->ownerId)) {
+                if (m_tagIndex.findById(tagId)->pid == lostFoundTagId) {
+                    postRescueDuplicates.push_back(tagId);
+                    logDebug() << "Found post-rescue duplicate: " << m_tagIndex.findById(tagId)->name << " (OwnerID: " << rescue.person->ownerId << ")" << std::endl;
+                }
             }
+        } else {
+            logError() << "Failed to rescue tag for: " << rescue.person->formattedName << " (OwnerID: " << rescue.person->ownerId << ")" << std::endl;
         }
+        syncProgress.advance();
+    }
 
-        // Commit transaction
-        if (!executeQuery(m_digiKamDb, "COMMIT;")) {
-            throw std::runtime_error("Failed to commit transaction");
+    // Post-rescue cleanup
+    phaseTimer.reset();
+    if (!postRescueDuplicates.empty()) {
+        PhaseTimer cleanupTimer(m_metrics, SyncPhase::PostRescueCleanup, true);
+        logInfo() << "Removing " << postRescueDuplicates.size() << " post-rescue duplicates from Lost & Found..." << std::endl;
+        if (!removeDuplicateTags(postRescueDuplicates)) {
+            throw std::runtime_error("Failed to remove post-rescue duplicate tags");
         }
+        logInfo() << "Post-rescue cleanup completed successfully" << std::endl;
+    }
 
-        // Get final counts for summary
-        auto finalRootsMagicTags = loadExistingDigiKamTags(parentTagName);
-        auto finalLostFoundTags = loadExistingDigiKamTags(lostFoundTagName);
+    logInfo() << "Found " << plan.creates.size() + plan.rescues.size() << " new people to process" << std::endl;
 
-        // Print summary
-        std::cout << "\nSynchronization completed successfully:" << std::endl;
-        std::cout << "  Tags created: " << m_tagsCreated << std::endl;
-        std::cout << "  Tags rescued from Lost & Found: " << m_tagsRescued << std::endl;
-        std::cout << "  Tags updated: " << m_tagsUpdated << std::endl;
-        std::cout << "  Tags moved to Lost & Found: " << m_tagsOrphaned << std::endl;
-        std::cout << "\nFinal Summary:" << std::endl;
-        std::cout << "  Names synchronized from RootsMagic: " << rmPeople.size() << std::endl;
-        std::cout << "  Tags in DigiKam RootsMagic tree: " << finalRootsMagicTags.size() << std::endl;
-        std::cout << "  Tags in DigiKam Lost & Found tree: " << finalLostFoundTags.size() << std::endl;
+    // Phase 4: Handle orphaned tags
+    if (!plan.orphanMoves.empty()) {
+        PhaseTimer orphanTimer(m_metrics, SyncPhase::OrphanMove, true);
+        logInfo() << "Moving " << plan.orphanMoves.size() << " orphaned tags to Lost & Found..." << std::endl;
+        if (!moveOrphanedTagsToLostFound(plan.orphanMoves, lostFoundTagId)) {
+            throw std::runtime_error("Failed to move orphaned tags to Lost & Found");
+        }
+    }
+}
 
-        return true;
+void RootsMagicSync::ensureOwnerIndex()
+{
+    // Created outside the sync transaction so the concurrent readers can use it too
+    if (!TagIndex::createLookupIndex(m_digiKamDb)) {
+        return;
+    }
 
-    } catch (const std::exception& e) {
-        std::cerr << "Error during synchronization: " << e.what() << std::endl;
-        executeQuery(m_digiKamDb, "ROLLBACK;");
+    // An expression index only helps queries spelling the expression the same way;
+    // streaming runs also read owner ids into their snapshot
+    bool used = TagIndex::lookupIndexUsed(m_digiKamDb, TagIndex::kPropertiesSql);
+    if (m_streaming) {
+        used = used && TagIndex::lookupIndexUsed(m_digiKamDb, tagSubtreeSql(kSnapshotSql));
+    }
+    if (used) {
+        logInfo() << "Owner and family ids are loaded through " << TagIndex::kLookupIndexName << std::endl;
+    } else {
+        logWarning() << "Warning: SQLite does not use " << TagIndex::kLookupIndexName
+                     << " to load owner and family ids" << std::endl;
+    }
+}
+
+bool RootsMagicSync::isDigiKamLocked()
+{
+    // A write lock taken and dropped at once is the cheapest way to ask
+    int rc = sqlite3_exec(m_digiKamDb, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr);
+    if (rc == SQLITE_OK) {
+        sqlite3_exec(m_digiKamDb, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    return (rc & 0xff) == SQLITE_BUSY || (rc & 0xff) == SQLITE_LOCKED;
+}
+
+long long RootsMagicSync::digiKamDataVersion()
+{
+    CachedStatement stmt(*m_digiKamStatements, "PRAGMA data_version");
+    return stmt && sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+}
+
+void RootsMagicSync::dropStaleTagIndex()
+{
+    // data_version only moves when another connection commits, e.g. DigiKam itself;
+    // until then the index still mirrors the database and the next run can reuse it
+    if (m_tagIndex.isLoaded() && (m_tagIndexVersion < 0 || digiKamDataVersion() != m_tagIndexVersion)) {
+        m_tagIndex.clear();
+    }
+}
+
+bool RootsMagicSync::canLoadConcurrently() const
+{
+    // Other connections would not see what earlier trees of a batch have written
+    if (!sqlite3_get_autocommit(m_digiKamDb)) {
+        return false;
+    }
+
+    // A second connection to an in-memory database would see an empty one
+    if (m_rootsMagicPath.empty() || m_rootsMagicPath == ":memory:") {
+        return false;
+    }
+    return sqlite3_threadsafe() != 0;
+}
+
+bool RootsMagicSync::loadConcurrently(const std::string& parentTagName, const std::string& lostFoundTagName,
+                                      std::vector<PersonRecord>& people,
+                                      IdTable<FamilyRecord>& families,
+                                      IdTable<DigiKamTag>& existingTags,
+                                      IdTable<DigiKamTag>& lostFoundTags)
+{
+    // Families get a RootsMagic connection of their own so both queries run at once.
+    // The DigiKam connection is only used by its worker until the threads are joined.
+    sqlite3* familyDb = openRootsMagicReader(m_rootsMagicPath, m_connectionSettings);
+    if (!familyDb) {
         return false;
     }
+    m_metrics.attach(familyDb);
+
+    // Each load logs into its own buffer; they are printed in serial order afterwards
+    std::ostringstream tagLog;
+    std::ostringstream peopleLog;
+    std::ostringstream familyLog;
+
+    // Workers fill arenas of their own, handed over to m_strings once joined
+    StringArena tagStrings;
+    StringArena familyStrings;
+    bool tagsLoaded = false;
+    {
+        StatementCache familyStatements(familyDb);
+
+        std::thread tagThread([&]() {
+            tagsLoaded = loadDigiKamTrees(parentTagName, lostFoundTagName, existingTags, lostFoundTags, tagStrings, tagLog);
+        });
+        std::thread familyThread([&]() {
+            families = loadFamilyData(familyDb, familyStatements, familyStrings, familyLog);
+        });
+
+        people = loadRootsMagicPeople(m_rootsMagicDb, *m_rootsMagicStatements, m_strings, peopleLog);
+
+        tagThread.join();
+        familyThread.join();
+    }
+    m_metrics.detach(familyDb);
+    sqlite3_close(familyDb);
+    m_strings.absorb(std::move(tagStrings));
+    m_strings.absorb(std::move(familyStrings));
+
+    logInfo() << tagLog.str() << peopleLog.str() << familyLog.str();
+    return tagsLoaded;
+}
+
+bool RootsMagicSync::loadDigiKamTrees(const std::string& parentTagName, const std::string& lostFoundTagName,
+                                      IdTable<DigiKamTag>& existingTags,
+                                      IdTable<DigiKamTag>& lostFoundTags,
+                                      StringArena& strings, std::ostream& log)
+{
+    // DigiKam is read once, into the index the sync keeps current as it writes;
+    // trees of a batch share it, so it is only reloaded after a rollback
+    PhaseTimer timer(m_metrics, SyncPhase::DigiKamLoad);
+    if (!m_tagIndex.isLoaded()) {
+        log << "Indexing DigiKam tag tree..." << std::endl;
+        if (!m_tagIndex.load(m_digiKamDb, *m_digiKamStatements)) {
+            return false;
+        }
+        timer.setRows(static_cast<long long>(m_tagIndex.size()));
+        log << "Indexed " << m_tagIndex.size() << " DigiKam tags" << std::endl;
+    }
+
+    existingTags = ownerTagsUnder(m_tagIndex.findByName(parentTagName), strings);
+    log << "Found " << existingTags.size() << " existing RootsMagic tags in DigiKam" << std::endl;
+    lostFoundTags = ownerTagsUnder(m_tagIndex.findByName(lostFoundTagName), strings);
+    log << "Found " << lostFoundTags.size() << " tags in Lost & Found" << std::endl;
+    return true;
 }
 
-std::vector<PersonRecord> RootsMagicSync::loadRootsMagicPeople()
+std::vector<PersonRecord> RootsMagicSync::loadRootsMagicPeople(sqlite3* db, StatementCache& statements,
+                                                               StringArena& strings, std::ostream& log)
 {
     std::vector<PersonRecord> people;
+    PhaseTimer timer(m_metrics, SyncPhase::RootsMagicLoad);
     
-    std::cout << "Loading people and family relationships..." << std::endl;
+    log << "Loading RootsMagic people..." << std::endl;
+    log << "Loading people and family relationships..." << std::endl;
     
     // Fixed query: Handle people in multiple families by selecting primary family only
     // This prevents duplicate PersonRecord creation for people in multiple families
@@ -321,73 +839,46 @@ std::vector<PersonRecord> RootsMagicSync::loadRootsMagicPeople()
         ORDER BY n.OwnerID
     )";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(m_rootsMagicDb, sql, -1, &stmt, nullptr);
+    CachedStatement stmt(statements, sql);
     
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to query RootsMagic NameTable: " << sqlite3_errmsg(m_rootsMagicDb) << std::endl;
+    if (!stmt) {
+        logError() << "Failed to query RootsMagic NameTable: " << sqlite3_errmsg(db) << std::endl;
         return people;
     }
 
     // First, count total rows for progress tracking
     int totalRows = 0;
-    sqlite3_stmt* countStmt;
     const char* countSql = "SELECT COUNT(*) FROM NameTable WHERE IsPrimary = 1";
-    int countRc = sqlite3_prepare_v2(m_rootsMagicDb, countSql, -1, &countStmt, nullptr);
-    if (countRc == SQLITE_OK) {
-        if (sqlite3_step(countStmt) == SQLITE_ROW) {
+    {
+        CachedStatement countStmt(statements, countSql);
+        if (countStmt && sqlite3_step(countStmt) == SQLITE_ROW) {
             totalRows = sqlite3_column_int(countStmt, 0);
         }
-        sqlite3_finalize(countStmt);
     }
     
-    std::cout << "Found " << totalRows << " people to process..." << std::endl;
+    log << "Found " << totalRows << " people to process..." << std::endl;
+    people.reserve(totalRows);
     
-    int processedRows = 0;
-    int lastProgressPercent = 0;
+    ProgressReporter progress(log, "Progress", "people", static_cast<size_t>(totalRows));
     
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        PersonRecord person;
-        person.ownerId = sqlite3_column_int(stmt, 0);
-        person.surname = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        person.given = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        person.birthYear = sqlite3_column_int(stmt, 3);
-        person.deathYear = sqlite3_column_int(stmt, 4);
-        
-        // Get family ID (may be NULL if person has no family)
-        if (sqlite3_column_type(stmt, 5) != SQLITE_NULL) {
-            person.familyId = sqlite3_column_int(stmt, 5);
-        } else {
-            person.familyId = 0; // No family
-        }
-        
-        // Trim whitespace
-        person.surname = person.surname.substr(0, person.surname.find_last_not_of(" \t") + 1);
-        person.given = person.given.substr(0, person.given.find_last_not_of(" \t") + 1);
-        
-        person.formattedName = formatPersonName(person);
-        people.push_back(person);
-        
-        // Progress tracking
-        processedRows++;
-        int currentProgressPercent = (processedRows * 100) / totalRows;
-        if (currentProgressPercent > lastProgressPercent) {
-            std::cout << "Progress: " << currentProgressPercent << "% (" << processedRows << "/" << totalRows << " people)" << std::endl;
-            lastProgressPercent = currentProgressPercent;
-        }
+        people.push_back(readPersonRow(stmt, strings));
+        progress.advance();
     }
 
-    sqlite3_finalize(stmt);
-    
-    std::cout << "Successfully loaded " << people.size() << " people with family relationships." << std::endl;
+    log << "Successfully loaded " << people.size() << " people with family relationships." << std::endl;
+    log << "Found " << people.size() << " people in RootsMagic" << std::endl;
+    timer.setRows(static_cast<long long>(people.size()));
     return people;
 }
 
-std::unordered_map<int, FamilyRecord> RootsMagicSync::loadFamilyData()
+IdTable<FamilyRecord> RootsMagicSync::loadFamilyData(sqlite3* db, StatementCache& statements,
+                                                                     StringArena& strings, std::ostream& log)
 {
-    std::unordered_map<int, FamilyRecord> families;
+    IdTable<FamilyRecord> families;
+    PhaseTimer timer(m_metrics, SyncPhase::FamilyLoad);
     
-    std::cout << "Loading family data..." << std::endl;
+    log << "Loading family data..." << std::endl;
     
     // Query family data from FamilyTable and get parent names from NameTable
     const char* sql = R"(
@@ -400,503 +891,1002 @@ std::unordered_map<int, FamilyRecord> RootsMagicSync::loadFamilyData()
         ORDER BY f.FamilyID
     )";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(m_rootsMagicDb, sql, -1, &stmt, nullptr);
+    CachedStatement stmt(statements, sql);
     
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to query RootsMagic FamilyTable: " << sqlite3_errmsg(m_rootsMagicDb) << std::endl;
+    if (!stmt) {
+        logError() << "Failed to query RootsMagic FamilyTable: " << sqlite3_errmsg(db) << std::endl;
         return families;
     }
     
     // Count total families for progress tracking
     int totalFamilies = 0;
-    sqlite3_stmt* countStmt;
     const char* countSql = "SELECT COUNT(*) FROM FamilyTable";
-    int countRc = sqlite3_prepare_v2(m_rootsMagicDb, countSql, -1, &countStmt, nullptr);
-    if (countRc == SQLITE_OK) {
-        if (sqlite3_step(countStmt) == SQLITE_ROW) {
+    {
+        CachedStatement countStmt(statements, countSql);
+        if (countStmt && sqlite3_step(countStmt) == SQLITE_ROW) {
             totalFamilies = sqlite3_column_int(countStmt, 0);
         }
-        sqlite3_finalize(countStmt);
     }
     
-    std::cout << "Found " << totalFamilies << " families to process..." << std::endl;
+    log << "Found " << totalFamilies << " families to process..." << std::endl;
+    families.reserve(totalFamilies);
     
-    int processedFamilies = 0;
-    int lastProgressPercent = 0;
+    ProgressReporter progress(log, "Family Progress", "families", static_cast<size_t>(totalFamilies));
 
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        FamilyRecord family;
-        family.familyId = sqlite3_column_int(stmt, 0);
-        family.fatherOwnerId = sqlite3_column_int(stmt, 1);
-        family.motherOwnerId = sqlite3_column_int(stmt, 2);
-        
-        // Get father's name (may be NULL)
-        if (sqlite3_column_type(stmt, 3) != SQLITE_NULL) {
-            family.fatherGiven = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-            family.fatherSurname = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        } else {
-            family.fatherGiven = "";
-            family.fatherSurname = "";
-        }
-        
-        // Get mother's name (may be NULL)
-        if (sqlite3_column_type(stmt, 5) != SQLITE_NULL) {
-            family.motherGiven = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-            family.motherSurname = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-        } else {
-            family.motherGiven = "";
-            family.motherSurname = "";
-        }
-        
-        // Trim whitespace
-        family.fatherGiven = family.fatherGiven.substr(0, family.fatherGiven.find_last_not_of(" \t") + 1);
-        family.fatherSurname = family.fatherSurname.substr(0, family.fatherSurname.find_last_not_of(" \t") + 1);
-        family.motherGiven = family.motherGiven.substr(0, family.motherGiven.find_last_not_of(" \t") + 1);
-        family.motherSurname = family.motherSurname.substr(0, family.motherSurname.find_last_not_of(" \t") + 1);
-        
-        family.familyTagName = formatFamilyTagName(family);
+        FamilyRecord family = readFamilyRow(stmt, strings);
         families[family.familyId] = family;
-        
-        // Progress tracking
-        processedFamilies++;
-        int currentProgressPercent = (processedFamilies * 100) / totalFamilies;
-        if (currentProgressPercent > lastProgressPercent) {
-            std::cout << "Family Progress: " << currentProgressPercent << "% (" << processedFamilies << "/" << totalFamilies << " families)" << std::endl;
-            lastProgressPercent = currentProgressPercent;
-        }
+        progress.advance();
     }
 
-    sqlite3_finalize(stmt);
-    std::cout << "Successfully loaded " << families.size() << " families." << std::endl;
+    log << "Successfully loaded " << families.size() << " families." << std::endl;
+    log << "Found " << families.size() << " families in RootsMagic" << std::endl;
+    timer.setRows(static_cast<long long>(families.size()));
     return families;
 }
 
-std::unordered_map<int, DigiKamTag> RootsMagicSync::loadExistingDigiKamTags(const std::string& parentTagName)
+bool RootsMagicSync::hasModificationDates()
 {
-    std::unordered_map<int, DigiKamTag> tags;
-    
-    std::string sql = R"(
-        SELECT t.id, t.name, CAST(tp.value AS INTEGER) as owner_id 
-        FROM Tags t 
-        JOIN TagProperties tp ON t.id = tp.tagid 
-        WHERE t.pid = (SELECT id FROM Tags WHERE name = ?)
-        AND tp.property = 'rootsmagic_owner_id'
+    // RootsMagic 8 and later stamp rows with UTCModDate; older files do not
+    const char* sql = "SELECT COUNT(*) FROM pragma_table_info(?) WHERE name = 'UTCModDate'";
+    for (const char* table : {"NameTable", "FamilyTable", "ChildTable"}) {
+        CachedStatement stmt(*m_rootsMagicStatements, sql);
+        if (!stmt) return false;
+        
+        sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_ROW || sqlite3_column_int(stmt, 0) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double RootsMagicSync::loadRootsMagicChangeMark()
+{
+    const char* sql = R"(
+        SELECT MAX(COALESCE((SELECT MAX(UTCModDate) FROM NameTable), 0),
+                   COALESCE((SELECT MAX(UTCModDate) FROM FamilyTable), 0),
+                   COALESCE((SELECT MAX(UTCModDate) FROM ChildTable), 0))
     )";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(m_digiKamDb, sql.c_str(), -1, &stmt, nullptr);
-    
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to query existing DigiKam tags: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
-        return tags;
+    CachedStatement stmt(*m_rootsMagicStatements, sql);
+    if (!stmt || sqlite3_step(stmt) != SQLITE_ROW) {
+        return -1.0;
     }
+    return sqlite3_column_double(stmt, 0);
+}
 
+double RootsMagicSync::readSyncMark(const std::string& parentTagName, int& parentTagId)
+{
+    const char* sql = R"(
+        SELECT tp.value, t.id FROM TagProperties tp
+        JOIN Tags t ON t.id = tp.tagid
+        WHERE t.pid = 0 AND t.name = ? AND tp.property = 'rootsmagic_sync_mark'
+    )";
+    CachedStatement stmt(*m_digiKamStatements, sql);
+    if (!stmt) return -1.0;
+    
     sqlite3_bind_text(stmt, 1, parentTagName.c_str(), -1, SQLITE_STATIC);
-
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        DigiKamTag tag;
-        tag.tagId = sqlite3_column_int(stmt, 0);
-        tag.name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        tag.ownerId = sqlite3_column_int(stmt, 2);
-        tag.isOrphaned = false;
-        
-        tags[tag.ownerId] = tag;
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        return -1.0;
     }
-
-    sqlite3_finalize(stmt);
-    return tags;
+    parentTagId = sqlite3_column_int(stmt, 1);
+    return sqlite3_column_double(stmt, 0);
 }
 
-bool RootsMagicSync::ensureParentTagExists(const std::string& tagName)
+bool RootsMagicSync::writeSyncMark(int parentTagId, double mark)
 {
-    std::string checkSql = "SELECT COUNT(*) FROM Tags WHERE name = ?";
-    sqlite3_stmt* stmt;
+    const char* deleteSql = "DELETE FROM TagProperties WHERE tagid = ? AND property = 'rootsmagic_sync_mark'";
+    {
+        CachedStatement stmt(*m_digiKamStatements, deleteSql);
+        if (!stmt) return false;
+        
+        sqlite3_bind_int(stmt, 1, parentTagId);
+        if (sqlite3_step(stmt) != SQLITE_DONE) return false;
+    }
     
-    int rc = sqlite3_prepare_v2(m_digiKamDb, checkSql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) return false;
+    // Stored as text with full precision so the next comparison is exact
+    char value[32];
+    std::snprintf(value, sizeof(value), "%.17g", mark);
     
-    sqlite3_bind_text(stmt, 1, tagName.c_str(), -1, SQLITE_STATIC);
+    const char* insertSql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, 'rootsmagic_sync_mark', ?)";
+    CachedStatement stmt(*m_digiKamStatements, insertSql);
+    if (!stmt) return false;
     
-    bool exists = false;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        exists = sqlite3_column_int(stmt, 0) > 0;
-    }
-    sqlite3_finalize(stmt);
+    sqlite3_bind_int(stmt, 1, parentTagId);
+    sqlite3_bind_text(stmt, 2, value, -1, SQLITE_TRANSIENT);
+    return sqlite3_step(stmt) == SQLITE_DONE;
+}
+
+IdSet RootsMagicSync::loadRootsMagicOwnerIds()
+{
+    IdSet ownerIds;
     
-    if (!exists) {
-        std::string createSql = "INSERT INTO Tags (name, pid, icon, iconkde) VALUES (?, 0, NULL, NULL)";
-        rc = sqlite3_prepare_v2(m_digiKamDb, createSql.c_str(), -1, &stmt, nullptr);
-        if (rc != SQLITE_OK) return false;
-        
-        sqlite3_bind_text(stmt, 1, tagName.c_str(), -1, SQLITE_STATIC);
-        rc = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
-        
-        return rc == SQLITE_DONE;
+    const char* sql = "SELECT OwnerID FROM NameTable WHERE IsPrimary = 1";
+    CachedStatement stmt(*m_rootsMagicStatements, sql);
+    if (!stmt) {
+        logError() << "Failed to query RootsMagic OwnerIDs: " << sqlite3_errmsg(m_rootsMagicDb) << std::endl;
+        return ownerIds;
     }
     
-    return true;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        ownerIds.insert(sqlite3_column_int(stmt, 0));
+    }
+    return ownerIds;
 }
 
-bool RootsMagicSync::createPersonTag(const PersonRecord& person, const std::string& parentTagName, 
-                                    const std::unordered_map<int, FamilyRecord>& families)
+bool RootsMagicSync::loadChangedRootsMagicData(double changedSince, int parentTagId,
+                                               const IdTable<DigiKamTag>& existingTags,
+                                               const IdTable<DigiKamTag>& lostFoundTags,
+                                               std::vector<PersonRecord>& people,
+                                               IdTable<FamilyRecord>& families,
+                                               IdSet& liveOwnerIds)
 {
-    // First check if tag already exists under RootsMagic parent with the same OwnerID
-    std::string checkRootsMagicSql = R"(
-        SELECT t.id FROM Tags t 
-        JOIN TagProperties tp ON t.id = tp.tagid 
-        WHERE t.name = ? AND t.pid = (SELECT id FROM Tags WHERE name = ?)
-        AND tp.property = 'rootsmagic_owner_id' AND CAST(tp.value AS INTEGER) = ?
+    std::optional<PhaseTimer> timer;
+    timer.emplace(m_metrics, SyncPhase::RootsMagicLoad);
+    liveOwnerIds = loadRootsMagicOwnerIds();
+
+    // Loaded whatever their date: people without a tag in either tree, and people with a family
+    // whose tag still sits directly under the parent tag, as older versions left them. Both id
+    // lists are bound as JSON arrays, so one statement reads everyone, changed or not.
+    std::string untaggedOwnerIds = "[";
+    liveOwnerIds.forEach([&](int ownerId) {
+        if (!existingTags.contains(ownerId) && !lostFoundTags.contains(ownerId)) {
+            untaggedOwnerIds += std::to_string(ownerId) + ",";
+        }
+    });
+    std::string flatOwnerIds = "[";
+    existingTags.forEach([&](int ownerId, const DigiKamTag& tag) {
+        if (tag.parentId == parentTagId) {
+            flatOwnerIds += std::to_string(ownerId) + ",";
+        }
+    });
+    for (std::string* ids : {&untaggedOwnerIds, &flatOwnerIds}) {
+        if (ids->back() == ',') ids->pop_back();
+        *ids += "]";
+    }
+
+    // People whose name row or family membership changed since the last sync, plus the ones above
+    const char* changedSql = R"(
+        SELECT 
+            n.OwnerID, n.Surname, n.Given, n.BirthYear, n.DeathYear,
+            COALESCE((SELECT MIN(FamilyID) FROM ChildTable WHERE ChildID = n.OwnerID), 0) as FamilyID
+        FROM NameTable n
+        WHERE n.IsPrimary = 1
+        AND (n.UTCModDate > ?1
+             OR n.OwnerID IN (SELECT ChildID FROM ChildTable WHERE UTCModDate > ?1)
+             OR n.OwnerID IN (SELECT value FROM json_each(?2))
+             OR (n.OwnerID IN (SELECT value FROM json_each(?3)) AND n.OwnerID IN (SELECT ChildID FROM ChildTable)))
+        ORDER BY n.OwnerID
     )";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(m_digiKamDb, checkRootsMagicSql.c_str(), -1, &stmt, nullptr);
-    if (rc == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, person.formattedName.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 2, parentTagName.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 3, person.ownerId);
+    {
+        CachedStatement stmt(*m_rootsMagicStatements, changedSql);
+        if (!stmt) {
+            logError() << "Failed to query changed RootsMagic people: " << sqlite3_errmsg(m_rootsMagicDb) << std::endl;
+            return false;
+        }
         
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            // Tag already exists under RootsMagic parent with same OwnerID - this is OK
-            sqlite3_finalize(stmt);
-            return true;
+        sqlite3_bind_double(stmt, 1, changedSince);
+        sqlite3_bind_text(stmt, 2, untaggedOwnerIds.c_str(), static_cast<int>(untaggedOwnerIds.size()), SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, flatOwnerIds.c_str(), static_cast<int>(flatOwnerIds.size()), SQLITE_STATIC);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            people.push_back(readPersonRow(stmt, m_strings));
         }
-        sqlite3_finalize(stmt);
     }
+    timer->setRows(static_cast<long long>(people.size()));
+    timer.reset();
     
-    // Check if tag exists in Lost & Found with the same OwnerID - if so, return false to trigger rescue
-    std::string checkLostFoundSql = R"(
-        SELECT t.id FROM Tags t 
-        JOIN TagProperties tp ON t.id = tp.tagid 
-        WHERE t.pid = (SELECT id FROM Tags WHERE name = 'Lost & Found')
-        AND tp.property = 'rootsmagic_owner_id' AND CAST(tp.value AS INTEGER) = ?
+    return loadFamiliesForPeople(people, families) && loadChangedFamilies(changedSince, families);
+}
+
+bool RootsMagicSync::loadFamiliesForPeople(const std::vector<PersonRecord>& people,
+                                           IdTable<FamilyRecord>& families)
+{
+    PhaseTimer timer(m_metrics, SyncPhase::FamilyLoad);
+    size_t familiesBefore = families.size();
+
+    // Only the families the given people belong to are loaded, bound as one JSON array of ids
+    std::string familyIds = "[";
+    for (const auto& person : people) {
+        if (person.familyId > 0 && !families.contains(person.familyId)) {
+            familyIds += std::to_string(person.familyId) + ",";
+        }
+    }
+    if (familyIds.back() == ',') familyIds.pop_back();
+    familyIds += "]";
+
+    const char* familySql = R"(
+        SELECT f.FamilyID, f.FatherID, f.MotherID,
+               fn1.Given as FatherGiven, fn1.Surname as FatherSurname,
+               fn2.Given as MotherGiven, fn2.Surname as MotherSurname
+        FROM FamilyTable f
+        LEFT JOIN NameTable fn1 ON f.FatherID = fn1.OwnerID AND fn1.IsPrimary = 1
+        LEFT JOIN NameTable fn2 ON f.MotherID = fn2.OwnerID AND fn2.IsPrimary = 1
+        WHERE f.FamilyID IN (SELECT value FROM json_each(?))
     )";
+    CachedStatement stmt(*m_rootsMagicStatements, familySql);
+    if (!stmt) {
+        logError() << "Failed to query RootsMagic families: " << sqlite3_errmsg(m_rootsMagicDb) << std::endl;
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, familyIds.c_str(), static_cast<int>(familyIds.size()), SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int familyId = sqlite3_column_int(stmt, 0);
+        families[familyId] = readFamilyRow(stmt, m_strings);
+    }
     
-    rc = sqlite3_prepare_v2(m_digiKamDb, checkLostFoundSql.c_str(), -1, &stmt, nullptr);
-    if (rc == SQLITE_OK) {
-        sqlite3_bind_int(stmt, 1, person.ownerId);
+    timer.setRows(static_cast<long long>(families.size() - familiesBefore));
+    return true;
+}
+
+bool RootsMagicSync::loadChangedFamilies(double changedSince, IdTable<FamilyRecord>& families)
+{
+    PhaseTimer timer(m_metrics, SyncPhase::FamilyLoad);
+    size_t familiesBefore = families.size();
+
+    // Families that changed or whose parents were renamed or deleted, so their tags follow the new names
+    const char* familySql = R"(
+        SELECT f.FamilyID, f.FatherID, f.MotherID,
+               fn1.Given as FatherGiven, fn1.Surname as FatherSurname,
+               fn2.Given as MotherGiven, fn2.Surname as MotherSurname
+        FROM FamilyTable f
+        LEFT JOIN NameTable fn1 ON f.FatherID = fn1.OwnerID AND fn1.IsPrimary = 1
+        LEFT JOIN NameTable fn2 ON f.MotherID = fn2.OwnerID AND fn2.IsPrimary = 1
+        WHERE f.UTCModDate > ?1
+        OR f.FatherID IN (SELECT OwnerID FROM NameTable WHERE IsPrimary = 1 AND UTCModDate > ?1)
+        OR f.MotherID IN (SELECT OwnerID FROM NameTable WHERE IsPrimary = 1 AND UTCModDate > ?1)
+        OR (f.FatherID > 0 AND fn1.OwnerID IS NULL) OR (f.MotherID > 0 AND fn2.OwnerID IS NULL)
+    )";
+    CachedStatement stmt(*m_rootsMagicStatements, familySql);
+    if (!stmt) {
+        logError() << "Failed to query changed RootsMagic families: " << sqlite3_errmsg(m_rootsMagicDb) << std::endl;
+        return false;
+    }
+
+    sqlite3_bind_double(stmt, 1, changedSince);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int familyId = sqlite3_column_int(stmt, 0);
+        if (!families.contains(familyId)) {
+            families[familyId] = readFamilyRow(stmt, m_strings);
+        }
+    }
+
+    timer.setRows(static_cast<long long>(families.size() - familiesBefore));
+    return true;
+}
+
+size_t RootsMagicSync::streamSynchronize(const std::string& parentTagName, const std::string& lostFoundTagName,
+                                         int parentTagId, int lostFoundTagId)
+{
+    // Both subtrees are copied once into a TEMP table keyed by (tree, owner), so every
+    // chunk can seek its own owner range without rescanning Tags
+    logInfo() << "Snapshotting DigiKam tags for streaming..." << std::endl;
+    if (!snapshotDigiKamTags(parentTagName, lostFoundTagName)) {
+        throw std::runtime_error("Failed to snapshot DigiKam tags");
+    }
+
+    size_t peopleStreamed = 0;
+    int lowerOwnerId = std::numeric_limits<int>::min();
+    for (int chunk = 1; ; chunk++) {
+        std::vector<PersonRecord> people;
+        if (!loadRootsMagicChunk(lowerOwnerId, m_streamChunkSize, people)) {
+            throw std::runtime_error("Failed to read RootsMagic people");
+        }
+
+        // The last chunk also owns every tag past the highest OwnerID, so trailing orphans are found
+        bool lastChunk = people.size() < m_streamChunkSize;
+        int upperOwnerId = lastChunk ? std::numeric_limits<int>::max() : people.back().ownerId;
+
+        IdTable<FamilyRecord> families;
+        IdTable<DigiKamTag> existingTags;
+        IdTable<DigiKamTag> lostFoundTags;
+        if (!loadFamiliesForPeople(people, families) ||
+            !loadSnapshotRange(0, lowerOwnerId, upperOwnerId, existingTags) ||
+            !loadSnapshotRange(1, lowerOwnerId, upperOwnerId, lostFoundTags)) {
+            throw std::runtime_error("Failed to load chunk " + std::to_string(chunk));
+        }
+
+        SyncPlan plan;
+        {
+            PhaseTimer timer(m_metrics, SyncPhase::Planning);
+            plan = buildSyncPlan(people, families, existingTags, lostFoundTags);
+            timer.setRows(static_cast<long long>(plan.changeCount()));
+        }
+        peopleStreamed += people.size();
+        logInfo() << "Chunk " << chunk << ": " << people.size() << " people, " << existingTags.size() << " tags, "
+                  << plan.changeCount() << " changes (" << peopleStreamed << " people so far)" << std::endl;
+
+        applySyncPlan(plan, parentTagId, lostFoundTagId);
+
+        // Nothing refers to this chunk's records any more
+        m_strings.clear();
+
+        if (lastChunk) break;
+        lowerOwnerId = upperOwnerId;
+    }
+
+    executeQuery(m_digiKamDb, "DELETE FROM temp.rms_stream_tags;");
+    return peopleStreamed;
+}
+
+const char* const RootsMagicSync::kSnapshotSql = R"(
+    SELECT ?2, CAST(tp.value AS INTEGER), t.id, t.pid, t.name
+    FROM subtree s
+    JOIN Tags t ON t.id = s.id
+    JOIN TagProperties tp ON t.id = tp.tagid
+    WHERE tp.property = 'rootsmagic_owner_id'
+    ORDER BY t.id
+)";
+
+bool RootsMagicSync::snapshotDigiKamTags(const std::string& parentTagName, const std::string& lostFoundTagName)
+{
+    PhaseTimer timer(m_metrics, SyncPhase::DigiKamLoad);
+
+    const char* createSql = R"(
+        CREATE TEMP TABLE IF NOT EXISTS rms_stream_tags (
+            tree INTEGER NOT NULL,
+            owner_id INTEGER NOT NULL,
+            tag_id INTEGER NOT NULL,
+            pid INTEGER NOT NULL,
+            name TEXT NOT NULL,
+            PRIMARY KEY (tree, owner_id)
+        ) WITHOUT ROWID
+    )";
+    if (!executeQuery(m_digiKamDb, createSql) || !executeQuery(m_digiKamDb, "DELETE FROM temp.rms_stream_tags;")) {
+        return false;
+    }
+
+    // OR REPLACE keeps the newest tag per owner, the same one ownerTagsUnder keeps
+    std::string snapshotSql = tagSubtreeSql(
+        (std::string("INSERT OR REPLACE INTO temp.rms_stream_tags (tree, owner_id, tag_id, pid, name)") +
+         kSnapshotSql).c_str());
+    // Rows copied into the snapshot are the rows this phase loads
+    long long rows = 0;
+    const std::string* treeNames[] = {&parentTagName, &lostFoundTagName};
+    for (int tree = 0; tree < 2; tree++) {
+        CachedStatement stmt(*m_digiKamStatements, snapshotSql);
+        if (!stmt) {
+            logError() << "Failed to prepare tag snapshot: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+            return false;
+        }
         
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            // Tag exists in Lost & Found with same OwnerID - return false to trigger rescue
-            sqlite3_finalize(stmt);
+        sqlite3_bind_text(stmt, 1, treeNames[tree]->c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, tree);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError() << "Failed to snapshot tags under " << *treeNames[tree] << ": " << sqlite3_errmsg(m_digiKamDb) << std::endl;
             return false;
         }
-        sqlite3_finalize(stmt);
+        rows += sqlite3_changes(m_digiKamDb);
     }
+    timer.setRows(rows);
+    return true;
+}
+
+bool RootsMagicSync::loadSnapshotRange(int tree, int lowerOwnerId, int upperOwnerId,
+                                       IdTable<DigiKamTag>& tags)
+{
+    PhaseTimer timer(m_metrics, SyncPhase::DigiKamLoad);
+    const char* sql = R"(
+        SELECT tag_id, pid, name, owner_id FROM temp.rms_stream_tags
+        WHERE tree = ? AND owner_id > ? AND owner_id <= ?
+        ORDER BY owner_id
+    )";
+    CachedStatement stmt(*m_digiKamStatements, sql);
+    if (!stmt) return false;
     
-    // Determine the appropriate parent tag for this person
-    std::string actualParentTagName = parentTagName;
-    
-    // Check if this person has a family
-    if (person.familyId > 0) {
-        auto familyIt = families.find(person.familyId);
-        if (familyIt != families.end()) {
-            const FamilyRecord& family = familyIt->second;
-            
-            // Create or ensure the family tag exists
-            if (!createFamilyTag(family, parentTagName)) {
-                std::cerr << "Failed to create family tag for: " << family.familyTagName << std::endl;
-                return false;
-            }
-            
-            // Use the family tag as the parent
-            actualParentTagName = family.familyTagName;
-        }
+    sqlite3_bind_int(stmt, 1, tree);
+    sqlite3_bind_int(stmt, 2, lowerOwnerId);
+    sqlite3_bind_int(stmt, 3, upperOwnerId);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        DigiKamTag tag;
+        tag.tagId = sqlite3_column_int(stmt, 0);
+        tag.parentId = sqlite3_column_int(stmt, 1);
+        tag.name = m_strings.store(columnView(stmt, 2));
+        tag.ownerId = sqlite3_column_int(stmt, 3);
+        tag.isOrphaned = false;
+        
+        tags[tag.ownerId] = tag;
     }
-    
-    // Create the person tag under the appropriate parent
-    std::string createTagSql = R"(
-        INSERT INTO Tags (name, pid, icon, iconkde) 
-        SELECT ?, id, NULL, 'user' FROM Tags WHERE name = ?
+    timer.setRows(static_cast<long long>(tags.size()));
+    return true;
+}
+
+bool RootsMagicSync::loadRootsMagicChunk(int afterOwnerId, size_t limit, std::vector<PersonRecord>& people)
+{
+    // Keyset pagination walks idxNameOwnerID in order; no sort, no OFFSET rescans
+    const char* sql = R"(
+        SELECT 
+            n.OwnerID, n.Surname, n.Given, n.BirthYear, n.DeathYear,
+            COALESCE((SELECT MIN(FamilyID) FROM ChildTable WHERE ChildID = n.OwnerID), 0) as FamilyID
+        FROM NameTable n
+        WHERE n.IsPrimary = 1 AND n.OwnerID > ?
+        ORDER BY n.OwnerID
+        LIMIT ?
     )";
-    
-    rc = sqlite3_prepare_v2(m_digiKamDb, createTagSql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare createPersonTag SQL: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+    CachedStatement stmt(*m_rootsMagicStatements, sql);
+    if (!stmt) {
+        logError() << "Failed to query RootsMagic NameTable: " << sqlite3_errmsg(m_rootsMagicDb) << std::endl;
         return false;
     }
     
-    sqlite3_bind_text(stmt, 1, person.formattedName.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, actualParentTagName.c_str(), -1, SQLITE_STATIC);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    PhaseTimer timer(m_metrics, SyncPhase::RootsMagicLoad);
+    people.reserve(limit);
+    sqlite3_bind_int(stmt, 1, afterOwnerId);
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(limit));
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        people.push_back(readPersonRow(stmt, m_strings));
+    }
+    timer.setRows(static_cast<long long>(people.size()));
+    return true;
+}
+
+PersonRecord RootsMagicSync::readPersonRow(sqlite3_stmt* stmt, StringArena& strings)
+{
+    PersonRecord person;
+    person.ownerId = sqlite3_column_int(stmt, 0);
+    
+    // Trimmed on SQLite's buffer, so only the final text is copied
+    person.surname = strings.store(trimTrailingWhitespace(columnView(stmt, 1)));
+    person.given = strings.store(trimTrailingWhitespace(columnView(stmt, 2)));
+    person.birthYear = sqlite3_column_int(stmt, 3);
+    person.deathYear = sqlite3_column_int(stmt, 4);
+    
+    // Get family ID (may be NULL if person has no family)
+    if (sqlite3_column_type(stmt, 5) != SQLITE_NULL) {
+        person.familyId = sqlite3_column_int(stmt, 5);
+    } else {
+        person.familyId = 0; // No family
+    }
     
-    if (rc != SQLITE_DONE) {
-        // Check if this is a UNIQUE constraint violation
-        std::string error = sqlite3_errmsg(m_digiKamDb);
-        if (error.find("UNIQUE constraint failed") != std::string::npos) {
-            // This means the tag exists somewhere else (probably Lost & Found)
-            return false; // Let the caller try rescue logic
-        }
-        std::cerr << "Failed to execute createPersonTag SQL: " << error << std::endl;
-        return false;
+    person.formattedName = formatPersonName(person, strings);
+    return person;
+}
+
+FamilyRecord RootsMagicSync::readFamilyRow(sqlite3_stmt* stmt, StringArena& strings)
+{
+    FamilyRecord family;
+    family.familyId = sqlite3_column_int(stmt, 0);
+    family.fatherOwnerId = sqlite3_column_int(stmt, 1);
+    family.motherOwnerId = sqlite3_column_int(stmt, 2);
+    
+    // Get father's name (may be NULL), trimmed before it is copied
+    if (sqlite3_column_type(stmt, 3) != SQLITE_NULL) {
+        family.fatherGiven = strings.store(trimTrailingWhitespace(columnView(stmt, 3)));
+        family.fatherSurname = strings.store(trimTrailingWhitespace(columnView(stmt, 4)));
     }
     
-    // Add properties
-    int tagId = sqlite3_last_insert_rowid(m_digiKamDb);
+    // Get mother's name (may be NULL)
+    if (sqlite3_column_type(stmt, 5) != SQLITE_NULL) {
+        family.motherGiven = strings.store(trimTrailingWhitespace(columnView(stmt, 5)));
+        family.motherSurname = strings.store(trimTrailingWhitespace(columnView(stmt, 6)));
+    }
     
-    std::string addOwnerIdSql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, 'rootsmagic_owner_id', ?)";
-    rc = sqlite3_prepare_v2(m_digiKamDb, addOwnerIdSql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare addOwnerIdSql: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
-        return false;
+    family.familyTagName = formatFamilyTagName(family, strings);
+    return family;
+}
+
+IdTable<DigiKamTag> RootsMagicSync::ownerTagsUnder(int rootTagId, StringArena& strings) const
+{
+    IdTable<DigiKamTag> tags;
+    if (rootTagId == 0) {
+        return tags;
+    }
+
+    // Person tags may sit directly under the root or under one of its family tags.
+    // An owner with several tags keeps the newest, as the streaming snapshot does.
+    m_tagIndex.forEachDescendant(rootTagId, [&](const TagIndexEntry& entry) {
+        if (entry.ownerId == 0) return;
+
+        const DigiKamTag* kept = tags.find(entry.ownerId);
+        if (kept && kept->tagId > entry.id) return;
+        tags[entry.ownerId] = DigiKamTag{entry.id, entry.pid, strings.store(entry.name), entry.ownerId, false};
+    });
+    return tags;
+}
+
+std::string RootsMagicSync::tagSubtreeSql(const char* query) const
+{
+    // The root is looked up like TagIndex::findByName: top level first, then lowest id
+    const char* rootSql = "(SELECT id FROM Tags WHERE name = ?1 ORDER BY pid <> 0, id LIMIT 1)";
+
+    // DigiKam's triggers keep TagsTree holding every (tag, ancestor) pair, so the
+    // whole subtree is one index range; without it the tree is walked level by level
+    std::string sql;
+    if (m_hasTagsTree) {
+        sql = std::string("WITH subtree(id) AS (SELECT id FROM TagsTree WHERE pid = ") + rootSql + ")";
+    } else {
+        sql = std::string("WITH RECURSIVE subtree(id) AS (SELECT id FROM Tags WHERE pid = ") + rootSql +
+              " UNION ALL SELECT t.id FROM Tags t JOIN subtree ON t.pid = subtree.id)";
+    }
+    return sql + query;
+}
+
+bool RootsMagicSync::ensureParentTagExists(const std::string& tagName, int& tagId)
+{
+    tagId = m_tagIndex.findByName(tagName);
+    if (tagId != 0) {
+        return true;
     }
     
-    sqlite3_bind_int(stmt, 1, tagId);
-    sqlite3_bind_int(stmt, 2, person.ownerId);
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    const char* createSql = "INSERT INTO Tags (name, pid, icon, iconkde) VALUES (?, 0, NULL, NULL)";
+    CachedStatement stmt(*m_digiKamStatements, createSql);
+    if (!stmt) return false;
     
-    if (rc != SQLITE_DONE) {
-        std::cerr << "Failed to execute addOwnerIdSql: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+    sqlite3_bind_text(stmt, 1, tagName.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) != SQLITE_DONE) return false;
+    
+    tagId = static_cast<int>(sqlite3_last_insert_rowid(m_digiKamDb));
+    m_tagIndex.addTag(tagId, 0, tagName);
+    return true;
+}
+
+bool RootsMagicSync::createPersonTag(const PersonRecord& person, int parentTagId)
+{
+    // A tag with this name under the same parent would violate Tags' UNIQUE (name, pid)
+    if (m_tagIndex.findChild(parentTagId, person.formattedName) != 0) {
         return false;
     }
     
-    std::string addPersonSql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, 'person', ?)";
-    rc = sqlite3_prepare_v2(m_digiKamDb, addPersonSql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare addPersonSql: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
-        return false;
+    // Create the person tag under the appropriate parent
+    const char* createTagSql = "INSERT INTO Tags (name, pid, icon, iconkde) VALUES (?, ?, NULL, 'user')";
+    {
+        CachedStatement stmt(*m_digiKamStatements, createTagSql);
+        if (!stmt) {
+            logError() << "Failed to prepare createPersonTag SQL: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+            return false;
+        }
+        
+        sqlite3_bind_text(stmt, 1, person.formattedName.data(), static_cast<int>(person.formattedName.size()), SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, parentTagId);
+        
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError() << "Failed to execute createPersonTag SQL: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+            return false;
+        }
     }
     
-    sqlite3_bind_int(stmt, 1, tagId);
-    sqlite3_bind_text(stmt, 2, person.formattedName.c_str(), -1, SQLITE_STATIC);
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    // Add properties
+    int tagId = static_cast<int>(sqlite3_last_insert_rowid(m_digiKamDb));
+    m_tagIndex.addTag(tagId, parentTagId, person.formattedName);
+    
+    const char* addOwnerIdSql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, 'rootsmagic_owner_id', ?)";
+    {
+        CachedStatement stmt(*m_digiKamStatements, addOwnerIdSql);
+        if (!stmt) {
+            logError() << "Failed to prepare addOwnerIdSql: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+            return false;
+        }
+        
+        sqlite3_bind_int(stmt, 1, tagId);
+        sqlite3_bind_int(stmt, 2, person.ownerId);
+        
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError() << "Failed to execute addOwnerIdSql: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+            return false;
+        }
+    }
+    m_tagIndex.setOwnerId(tagId, person.ownerId);
     
-    if (rc != SQLITE_DONE) {
-        std::cerr << "Failed to execute addPersonSql: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
-        return false;
+    const char* addPersonSql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, 'person', ?)";
+    {
+        CachedStatement stmt(*m_digiKamStatements, addPersonSql);
+        if (!stmt) {
+            logError() << "Failed to prepare addPersonSql: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+            return false;
+        }
+        
+        sqlite3_bind_int(stmt, 1, tagId);
+        sqlite3_bind_text(stmt, 2, person.formattedName.data(), static_cast<int>(person.formattedName.size()), SQLITE_STATIC);
+        
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError() << "Failed to execute addPersonSql: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+            return false;
+        }
     }
     
     return true;
 }
 
-bool RootsMagicSync::createFamilyTag(const FamilyRecord& family, const std::string& parentTagName)
+IdTable<int> RootsMagicSync::materializeFamilyTags(const std::vector<const FamilyRecord*>& families,
+                                                  const std::vector<const FamilyRecord*>& refreshOnly,
+                                                  int parentTagId)
 {
-    // Check if family tag already exists
-    std::string checkSql = "SELECT COUNT(*) FROM Tags WHERE name = ?";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(m_digiKamDb, checkSql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) return false;
-    
-    sqlite3_bind_text(stmt, 1, family.familyTagName.c_str(), -1, SQLITE_STATIC);
-    
-    bool exists = false;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        exists = sqlite3_column_int(stmt, 0) > 0;
+    PhaseTimer timer(m_metrics, SyncPhase::FamilyTags, true);
+    IdTable<int> familyTagIds;
+    familyTagIds.reserve(families.size());
+
+    // A family's tag is the one under the parent holding its family_id. Older
+    // versions made a new tag each time a family's name changed, so there can
+    // be several: the one with the current name, or else the oldest, is kept
+    // and renamed, and the others are collapsed into it. Families in refreshOnly
+    // only have existing tags brought up to date.
+    std::vector<const FamilyRecord*> missing;
+    std::vector<std::pair<int, std::string_view>> renames;
+    std::vector<std::pair<int, int>> merges;  // Stale tag, tag it is collapsed into
+    std::unordered_set<std::string_view> renamedTo;
+    std::unordered_set<std::string> movedChildren;  // "keep id/name" of tags moved by merges
+    const std::vector<const FamilyRecord*>* lists[] = {&families, &refreshOnly};
+    for (int list = 0; list < 2; list++) {
+        for (const FamilyRecord* family : *lists[list]) {
+            std::vector<int> candidates;
+            for (int tagId : m_tagIndex.tagsForFamily(family->familyId)) {
+                if (m_tagIndex.findById(tagId)->pid == parentTagId) {
+                    candidates.push_back(tagId);
+                }
+            }
+
+            // Without one, a tag that already holds the name is used as it is
+            int namedTagId = m_tagIndex.findChild(parentTagId, family->familyTagName);
+            if (candidates.empty()) {
+                if (list == 1) {
+                    continue;
+                }
+                if (namedTagId != 0) {
+                    familyTagIds[family->familyId] = namedTagId;
+                } else {
+                    missing.push_back(family);
+                }
+                continue;
+            }
+
+            int keepId = namedTagId;
+            if (std::find(candidates.begin(), candidates.end(), keepId) == candidates.end()) {
+                keepId = *std::min_element(candidates.begin(), candidates.end());
+                const std::string& oldName = m_tagIndex.findById(keepId)->name;
+                if (namedTagId != 0 || !renamedTo.insert(family->familyTagName).second) {
+                    logWarning() << "Warning: Cannot rename family tag '" << oldName << "' to '" << family->familyTagName
+                                 << "', another tag already has that name" << std::endl;
+                } else {
+                    logDebug() << "Renaming family tag: '" << oldName << "' -> '" << family->familyTagName << "'" << std::endl;
+                    renames.emplace_back(keepId, family->familyTagName);
+                }
+            }
+            familyTagIds[family->familyId] = keepId;
+
+            for (int staleId : candidates) {
+                if (staleId == keepId) continue;
+
+                // Tags is UNIQUE (name, pid), so a child whose name the kept tag already has blocks the merge
+                std::vector<std::string> childKeys;
+                bool collapsible = true;
+                for (int childId : m_tagIndex.childrenOf(staleId)) {
+                    const std::string& childName = m_tagIndex.findById(childId)->name;
+                    childKeys.push_back(std::to_string(keepId) + "/" + childName);
+                    if (m_tagIndex.findChild(keepId, childName) != 0 || movedChildren.count(childKeys.back())) {
+                        collapsible = false;
+                    }
+                }
+                const std::string& staleName = m_tagIndex.findById(staleId)->name;
+                if (!collapsible) {
+                    logWarning() << "Warning: Stale family tag '" << staleName << "' (TagID: " << staleId
+                                 << ") was left in place, it holds a tag of the same name as the current family tag" << std::endl;
+                    continue;
+                }
+                movedChildren.insert(childKeys.begin(), childKeys.end());
+                logDebug() << "Collapsing stale family tag: '" << staleName << "' (TagID: " << staleId << ", FamilyID: "
+                           << family->familyId << ")" << std::endl;
+                merges.emplace_back(staleId, keepId);
+            }
+        }
     }
-    sqlite3_finalize(stmt);
-    
-    if (exists) {
-        // Family tag already exists, no need to create it
-        return true;
+
+    // Collapsing first frees the stale tags' names for the renames
+    if (!merges.empty()) {
+        logInfo() << "Collapsing " << merges.size() << " stale family tags into their family's tag..." << std::endl;
+        if (!collapseFamilyTags(merges)) {
+            throw std::runtime_error("Failed to collapse stale family tags");
+        }
+        m_familyTagsCollapsed += static_cast<int>(merges.size());
     }
-    
-    // Create the family tag under the RootsMagic parent
-    std::string createSql = R"(
-        INSERT INTO Tags (name, pid, icon, iconkde) 
-        SELECT ?, id, NULL, 'user' FROM Tags WHERE name = ?
+    if (!renames.empty()) {
+        logInfo() << "Renaming " << renames.size() << " family tags..." << std::endl;
+        if (!renameFamilyTags(renames)) {
+            throw std::runtime_error("Failed to rename family tags");
+        }
+        m_familyTagsRenamed += static_cast<int>(renames.size());
+    }
+    if (missing.empty()) {
+        return familyTagIds;
+    }
+
+    logInfo() << "Creating " << missing.size() << " family tags..." << std::endl;
+    BulkTagWriter writer(m_digiKamDb, *m_digiKamStatements, m_tagIndex);
+    if (!writer.begin()) {
+        throw std::runtime_error("Failed to set up family tag staging");
+    }
+    for (const FamilyRecord* family : missing) {
+        // Families whose names come out the same share the first one's tag
+        writer.stageFamilyTag(family->familyId, parentTagId, family->familyTagName);
+    }
+    if (!writer.flush()) {
+        throw std::runtime_error("Failed to write family tags");
+    }
+
+    for (const FamilyRecord* family : missing) {
+        int tagId = writer.createdFamilyTagId(family->familyId);
+        if (tagId == 0) {
+            tagId = m_tagIndex.findChild(parentTagId, family->familyTagName);
+        }
+        if (tagId != 0) {
+            familyTagIds[family->familyId] = tagId;
+        } else {
+            logError() << "Failed to create family tag for: " << family->familyTagName << std::endl;
+        }
+    }
+    return familyTagIds;
+}
+
+bool RootsMagicSync::renameFamilyTags(const std::vector<std::pair<int, std::string_view>>& renames)
+{
+    const char* createSql = R"(
+        CREATE TEMP TABLE IF NOT EXISTS rms_family_renames (
+            tag_id INTEGER PRIMARY KEY,
+            name TEXT NOT NULL
+        )
     )";
-    
-    rc = sqlite3_prepare_v2(m_digiKamDb, createSql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare createFamilyTag SQL: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+    if (!executeQuery(m_digiKamDb, createSql) || !executeQuery(m_digiKamDb, "DELETE FROM temp.rms_family_renames;")) {
         return false;
     }
-    
-    sqlite3_bind_text(stmt, 1, family.familyTagName.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, parentTagName.c_str(), -1, SQLITE_STATIC);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    if (rc != SQLITE_DONE) {
-        std::cerr << "Failed to execute createFamilyTag SQL: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+
+    const char* stageSql = "INSERT INTO temp.rms_family_renames (tag_id, name) VALUES (?, ?)";
+    for (const auto& [tagId, name] : renames) {
+        CachedStatement stmt(*m_digiKamStatements, stageSql);
+        if (!stmt) return false;
+
+        sqlite3_bind_int(stmt, 1, tagId);
+        sqlite3_bind_text(stmt, 2, name.data(), static_cast<int>(name.size()), SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError() << "Failed to stage family tag rename: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+            return false;
+        }
+    }
+
+    const char* renameSql = R"(
+        UPDATE Tags SET name = r.name
+        FROM temp.rms_family_renames r WHERE Tags.id = r.tag_id
+    )";
+    if (!executeQuery(m_digiKamDb, renameSql)) {
         return false;
     }
-    
-    // Add family properties
-    int tagId = sqlite3_last_insert_rowid(m_digiKamDb);
-    
-    std::string addFamilyIdSql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, 'family_id', ?)";
-    rc = sqlite3_prepare_v2(m_digiKamDb, addFamilyIdSql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare addFamilyIdSql: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+
+    for (const auto& [tagId, name] : renames) {
+        m_tagIndex.renameTag(tagId, name);
+    }
+    return true;
+}
+
+bool RootsMagicSync::collapseFamilyTags(const std::vector<std::pair<int, int>>& merges)
+{
+    const char* createSql = R"(
+        CREATE TEMP TABLE IF NOT EXISTS rms_family_merges (
+            stale_id INTEGER PRIMARY KEY,
+            keep_id INTEGER NOT NULL
+        )
+    )";
+    if (!executeQuery(m_digiKamDb, createSql) || !executeQuery(m_digiKamDb, "DELETE FROM temp.rms_family_merges;")) {
         return false;
     }
-    
-    sqlite3_bind_int(stmt, 1, tagId);
-    sqlite3_bind_int(stmt, 2, family.familyId);
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    if (rc != SQLITE_DONE) {
-        std::cerr << "Failed to execute addFamilyIdSql: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+
+    const char* stageSql = "INSERT INTO temp.rms_family_merges (stale_id, keep_id) VALUES (?, ?)";
+    for (const auto& [staleId, keepId] : merges) {
+        CachedStatement stmt(*m_digiKamStatements, stageSql);
+        if (!stmt) return false;
+
+        sqlite3_bind_int(stmt, 1, staleId);
+        sqlite3_bind_int(stmt, 2, keepId);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError() << "Failed to stage family tag merge: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+            return false;
+        }
+    }
+
+    // Children and photos move to the kept tag before DigiKam's delete trigger
+    // would take them with the stale one; photos already on both stay behind
+    const char* moveChildrenSql = R"(
+        UPDATE Tags SET pid = m.keep_id
+        FROM temp.rms_family_merges m WHERE Tags.pid = m.stale_id
+    )";
+    const char* moveImagesSql = R"(
+        UPDATE OR IGNORE ImageTags SET tagid = m.keep_id
+        FROM temp.rms_family_merges m WHERE ImageTags.tagid = m.stale_id
+    )";
+    const char* deletePropertiesSql = "DELETE FROM TagProperties WHERE tagid IN (SELECT stale_id FROM temp.rms_family_merges)";
+    const char* deleteTagsSql = "DELETE FROM Tags WHERE id IN (SELECT stale_id FROM temp.rms_family_merges)";
+    if (!executeQuery(m_digiKamDb, moveChildrenSql) || !executeQuery(m_digiKamDb, moveImagesSql) ||
+        !executeQuery(m_digiKamDb, deletePropertiesSql) || !executeQuery(m_digiKamDb, deleteTagsSql)) {
         return false;
     }
-    
+
+    for (const auto& [staleId, keepId] : merges) {
+        for (int childId : m_tagIndex.childrenOf(staleId)) {
+            m_tagIndex.moveTag(childId, keepId);
+        }
+        m_tagIndex.removeTag(staleId);
+    }
     return true;
 }
 
 bool RootsMagicSync::updatePersonTag(int tagId, const PersonRecord& person)
 {
     // Update tag name
-    std::string updateSql = "UPDATE Tags SET name = ? WHERE id = ?";
-    sqlite3_stmt* stmt;
+    const char* updateSql = "UPDATE Tags SET name = ? WHERE id = ?";
+    {
+        CachedStatement stmt(*m_digiKamStatements, updateSql);
+        if (!stmt) return false;
+        
+        sqlite3_bind_text(stmt, 1, person.formattedName.data(), static_cast<int>(person.formattedName.size()), SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, tagId);
+        
+        if (sqlite3_step(stmt) != SQLITE_DONE) return false;
+    }
+    m_tagIndex.renameTag(tagId, person.formattedName);
     
-    int rc = sqlite3_prepare_v2(m_digiKamDb, updateSql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) return false;
+    // Update person property
+    const char* updatePersonSql = "UPDATE TagProperties SET value = ? WHERE tagid = ? AND property = 'person'";
+    CachedStatement stmt(*m_digiKamStatements, updatePersonSql);
+    if (!stmt) return false;
     
-    sqlite3_bind_text(stmt, 1, person.formattedName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 1, person.formattedName.data(), static_cast<int>(person.formattedName.size()), SQLITE_STATIC);
     sqlite3_bind_int(stmt, 2, tagId);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    if (rc != SQLITE_DONE) return false;
-    
-    // Update person property
-    std::string updatePersonSql = "UPDATE TagProperties SET value = ? WHERE tagid = ? AND property = 'person'";
-    rc = sqlite3_prepare_v2(m_digiKamDb, updatePersonSql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) return false;
+    return sqlite3_step(stmt) == SQLITE_DONE;
+}
+
+bool RootsMagicSync::moveTag(int tagId, int newParentTagId)
+{
+    const char* updateSql = "UPDATE Tags SET pid = ? WHERE id = ?";
+    CachedStatement stmt(*m_digiKamStatements, updateSql);
+    if (!stmt) return false;
     
-    sqlite3_bind_text(stmt, 1, person.formattedName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 1, newParentTagId);
     sqlite3_bind_int(stmt, 2, tagId);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    if (sqlite3_step(stmt) != SQLITE_DONE) return false;
     
-    return rc == SQLITE_DONE;
+    m_tagIndex.moveTag(tagId, newParentTagId);
+    return true;
 }
 
-bool RootsMagicSync::moveOrphanedTagsToLostFound(const std::vector<int>& orphanedTagIds, 
-                                                const std::string& lostFoundTagName,
-                                                const std::unordered_map<int, DigiKamTag>& existingTags)
+bool RootsMagicSync::moveTags(const std::vector<std::pair<int, int>>& moves)
 {
-    if (orphanedTagIds.empty()) return true;
-    
-    std::string updateSql = "UPDATE Tags SET pid = (SELECT id FROM Tags WHERE name = ?) WHERE id = ?";
-    sqlite3_stmt* stmt;
-    
-    for (int tagId : orphanedTagIds) {
-        // Find the tag name for logging
-        std::string tagName = "Unknown";
-        int ownerId = -1;
-        for (const auto& [ownerIdKey, tag] : existingTags) {
-            if (tag.tagId == tagId) {
-                tagName = tag.name;
-                ownerId = ownerIdKey;
-                break;
-            }
+    if (moves.empty()) return true;
+
+    const char* createSql = R"(
+        CREATE TEMP TABLE IF NOT EXISTS rms_tag_moves (
+            tag_id INTEGER PRIMARY KEY,
+            pid INTEGER NOT NULL
+        )
+    )";
+    if (!executeQuery(m_digiKamDb, createSql) || !executeQuery(m_digiKamDb, "DELETE FROM temp.rms_tag_moves;")) {
+        return false;
+    }
+
+    const char* stageSql = "INSERT INTO temp.rms_tag_moves (tag_id, pid) VALUES (?, ?)";
+    for (const auto& [tagId, newParentTagId] : moves) {
+        CachedStatement stmt(*m_digiKamStatements, stageSql);
+        if (!stmt) return false;
+
+        sqlite3_bind_int(stmt, 1, tagId);
+        sqlite3_bind_int(stmt, 2, newParentTagId);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError() << "Failed to stage tag move: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+            return false;
         }
-        
-        int rc = sqlite3_prepare_v2(m_digiKamDb, updateSql.c_str(), -1, &stmt, nullptr);
-        if (rc != SQLITE_OK) return false;
-        
-        sqlite3_bind_text(stmt, 1, lostFoundTagName.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 2, tagId);
-        
-        rc = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
-        
-        if (rc != SQLITE_DONE) return false;
-        
-        // Log the move
-        std::cout << "Moved to Lost & Found: '" << tagName << "' (OwnerID: " << ownerId << ", TagID: " << tagId << ")" << std::endl;
     }
-    
+
+    // DigiKam's move trigger looks TagsTree up by pid several times per row and
+    // TagsTree has no index on pid. An index that lives only inside this
+    // transaction turns those scans into searches and leaves the schema as it was.
+    bool treeIndex = m_hasTagsTree && moves.size() >= kTreeIndexMinMoves && !hasTreeParentIndex();
+    if (treeIndex && !executeQuery(m_digiKamDb, "CREATE INDEX rms_tagstree_pid ON TagsTree (pid);")) {
+        return false;
+    }
+
+    const char* moveSql = R"(
+        UPDATE Tags SET pid = m.pid
+        FROM temp.rms_tag_moves m WHERE Tags.id = m.tag_id
+    )";
+    bool moved = executeQuery(m_digiKamDb, moveSql);
+    if (treeIndex && !executeQuery(m_digiKamDb, "DROP INDEX rms_tagstree_pid;")) {
+        return false;
+    }
+    if (!moved) {
+        return false;
+    }
+
+    for (const auto& [tagId, newParentTagId] : moves) {
+        m_tagIndex.moveTag(tagId, newParentTagId);
+    }
     return true;
 }
 
-bool RootsMagicSync::rescueTagFromLostFound(const PersonRecord& person, const std::string& parentTagName, 
-                                           const std::unordered_map<int, DigiKamTag>& lostFoundTags)
+bool RootsMagicSync::hasTreeParentIndex()
+{
+    const char* sql = R"(
+        SELECT COUNT(*) FROM pragma_index_list('TagsTree') l
+        WHERE (SELECT name FROM pragma_index_info(l.name) WHERE seqno = 0) = 'pid'
+    )";
+    CachedStatement stmt(*m_digiKamStatements, sql);
+    return stmt && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0;
+}
+
+bool RootsMagicSync::moveOrphanedTagsToLostFound(const std::vector<const DigiKamTag*>& orphanedTags, 
+                                                int lostFoundTagId)
 {
-    // Check if this person exists in Lost & Found
-    auto it = lostFoundTags.find(person.ownerId);
-    if (it == lostFoundTags.end()) {
-        return false; // Not in Lost & Found
+    std::vector<std::pair<int, int>> moves;
+    std::vector<int> movedOwnerIds;
+    std::unordered_set<std::string_view> movedNames;
+    for (const DigiKamTag* tag : orphanedTags) {
+        // One name clash would fail the whole batch
+        if (m_tagIndex.findChild(lostFoundTagId, tag->name) != 0 || !movedNames.insert(tag->name).second) {
+            logWarning() << "Warning: Cannot move '" << tag->name << "' (OwnerID: " << tag->ownerId
+                         << ") to Lost & Found, it already holds a tag of that name" << std::endl;
+            continue;
+        }
+        logDebug() << "Moving to Lost & Found: '" << tag->name << "' (OwnerID: " << tag->ownerId << ", TagID: " << tag->tagId << ")" << std::endl;
+        moves.emplace_back(tag->tagId, lostFoundTagId);
+        movedOwnerIds.push_back(tag->ownerId);
     }
-    
-    std::cout << "Rescuing from Lost & Found: " << it->second.name << " (OwnerID: " << person.ownerId << ")" << std::endl;
-    
-    // Move the tag from Lost & Found to RootsMagic parent
-    std::string updateSql = "UPDATE Tags SET pid = (SELECT id FROM Tags WHERE name = ?) WHERE id = ?";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(m_digiKamDb, updateSql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare rescue SQL: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+
+    if (!moveTags(moves)) {
+        logError() << "Failed to move orphaned tags to Lost & Found" << std::endl;
         return false;
     }
+    m_orphanedOwnerIds.insert(m_orphanedOwnerIds.end(), movedOwnerIds.begin(), movedOwnerIds.end());
+    return true;
+}
+
+bool RootsMagicSync::rescueTagFromLostFound(const DigiKamTag& lostTag, const PersonRecord& person, int parentTagId)
+{
+    logDebug() << "Rescuing from Lost & Found: " << lostTag.name << " (OwnerID: " << person.ownerId << ")" << std::endl;
     
-    sqlite3_bind_text(stmt, 1, parentTagName.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 2, it->second.tagId);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    if (rc != SQLITE_DONE) {
-        std::cerr << "Failed to execute rescue SQL: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
+    // Move the tag from Lost & Found to its parent in the RootsMagic tree
+    if (!moveTag(lostTag.tagId, parentTagId)) {
+        logError() << "Failed to execute rescue SQL: " << sqlite3_errmsg(m_digiKamDb) << std::endl;
         return false;
     }
     
     // Update the tag name if needed
     bool nameWasUpdated = false;
-    if (it->second.name != person.formattedName) {
-        if (updatePersonTag(it->second.tagId, person)) {
+    if (lostTag.name != person.formattedName) {
+        if (updatePersonTag(lostTag.tagId, person)) {
             nameWasUpdated = true;
-            std::cout << "Updated rescued tag name: '" << it->second.name << "' -> '" << person.formattedName << "'" << std::endl;
+            logDebug() << "Updated rescued tag name: '" << lostTag.name << "' -> '" << person.formattedName << "'" << std::endl;
         }
     }
     
     // Ensure the rescued tag has proper RootsMagic properties
     // First, check if rootsmagic_owner_id property already exists
-    std::string checkOwnerIdSql = "SELECT COUNT(*) FROM TagProperties WHERE tagid = ? AND property = 'rootsmagic_owner_id'";
-    rc = sqlite3_prepare_v2(m_digiKamDb, checkOwnerIdSql.c_str(), -1, &stmt, nullptr);
-    if (rc == SQLITE_OK) {
-        sqlite3_bind_int(stmt, 1, it->second.tagId);
-        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) == 0) {
-            sqlite3_finalize(stmt);
-            
-            // Add missing rootsmagic_owner_id property
-            std::string addOwnerIdSql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, 'rootsmagic_owner_id', ?)";
-            rc = sqlite3_prepare_v2(m_digiKamDb, addOwnerIdSql.c_str(), -1, &stmt, nullptr);
-            if (rc == SQLITE_OK) {
-                sqlite3_bind_int(stmt, 1, it->second.tagId);
-                sqlite3_bind_int(stmt, 2, person.ownerId);
-                sqlite3_step(stmt);
-                sqlite3_finalize(stmt);
+    const TagIndexEntry* entry = m_tagIndex.findById(lostTag.tagId);
+    if (entry && entry->ownerId == 0) {
+        // Add missing rootsmagic_owner_id property
+        const char* addOwnerIdSql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, 'rootsmagic_owner_id', ?)";
+        CachedStatement addStmt(*m_digiKamStatements, addOwnerIdSql);
+        if (addStmt) {
+            sqlite3_bind_int(addStmt, 1, lostTag.tagId);
+            sqlite3_bind_int(addStmt, 2, person.ownerId);
+            if (sqlite3_step(addStmt) == SQLITE_DONE) {
+                m_tagIndex.setOwnerId(lostTag.tagId, person.ownerId);
             }
-        } else {
-            sqlite3_finalize(stmt);
         }
     }
     
     // Ensure person property exists and is correct (only if we didn't already update it)
     if (!nameWasUpdated) {
         // Check if person property already exists
-        std::string checkPersonSql = "SELECT COUNT(*) FROM TagProperties WHERE tagid = ? AND property = 'person'";
-        rc = sqlite3_prepare_v2(m_digiKamDb, checkPersonSql.c_str(), -1, &stmt, nullptr);
-        if (rc == SQLITE_OK) {
-            sqlite3_bind_int(stmt, 1, it->second.tagId);
+        const char* checkPersonSql = "SELECT COUNT(*) FROM TagProperties WHERE tagid = ? AND property = 'person'";
+        CachedStatement stmt(*m_digiKamStatements, checkPersonSql);
+        if (stmt) {
+            sqlite3_bind_int(stmt, 1, lostTag.tagId);
             if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) == 0) {
-                sqlite3_finalize(stmt);
-                
                 // Add missing person property
-                std::string addPersonSql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, 'person', ?)";
-                rc = sqlite3_prepare_v2(m_digiKamDb, addPersonSql.c_str(), -1, &stmt, nullptr);
-                if (rc == SQLITE_OK) {
-                    sqlite3_bind_int(stmt, 1, it->second.tagId);
-                    sqlite3_bind_text(stmt, 2, person.formattedName.c_str(), -1, SQLITE_STATIC);
-                    sqlite3_step(stmt);
-                    sqlite3_finalize(stmt);
+                const char* addPersonSql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, 'person', ?)";
+                CachedStatement addStmt(*m_digiKamStatements, addPersonSql);
+                if (addStmt) {
+                    sqlite3_bind_int(addStmt, 1, lostTag.tagId);
+                    sqlite3_bind_text(addStmt, 2, person.formattedName.data(), static_cast<int>(person.formattedName.size()), SQLITE_STATIC);
+                    sqlite3_step(addStmt);
                 }
-            } else {
-                sqlite3_finalize(stmt);
             }
         }
     }
@@ -910,66 +1900,71 @@ bool RootsMagicSync::removeDuplicateTags(const std::vector<int>& tagIds)
 {
     if (tagIds.empty()) return true;
     
-    std::cout << "Permanently removing duplicate tags and their properties..." << std::endl;
+    logInfo() << "Permanently removing duplicate tags and their properties..." << std::endl;
+    
+    const char* deletePropertiesSql = "DELETE FROM TagProperties WHERE tagid = ?";
+    const char* deleteTagSql = "DELETE FROM Tags WHERE id = ?";
     
     for (int tagId : tagIds) {
         // First delete all TagProperties for this tag
-        std::string deletePropertiesSql = "DELETE FROM TagProperties WHERE tagid = ?";
-        sqlite3_stmt* stmt;
-        int rc = sqlite3_prepare_v2(m_digiKamDb, deletePropertiesSql.c_str(), -1, &stmt, nullptr);
-        if (rc == SQLITE_OK) {
+        {
+            CachedStatement stmt(*m_digiKamStatements, deletePropertiesSql);
+            if (!stmt) return false;
             sqlite3_bind_int(stmt, 1, tagId);
-            sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                logError() << "Failed to delete properties of duplicate tag with ID: " << tagId << std::endl;
+                return false;
+            }
         }
         
         // Then delete the tag itself
-        std::string deleteTagSql = "DELETE FROM Tags WHERE id = ?";
-        rc = sqlite3_prepare_v2(m_digiKamDb, deleteTagSql.c_str(), -1, &stmt, nullptr);
-        if (rc == SQLITE_OK) {
-            sqlite3_bind_int(stmt, 1, tagId);
-            rc = sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
-            
-            if (rc != SQLITE_DONE) {
-                std::cerr << "Failed to delete duplicate tag with ID: " << tagId << std::endl;
-                return false;
-            }
+        CachedStatement stmt(*m_digiKamStatements, deleteTagSql);
+        if (!stmt) return false;
+        sqlite3_bind_int(stmt, 1, tagId);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError() << "Failed to delete duplicate tag with ID: " << tagId << std::endl;
+            return false;
         }
+        m_tagIndex.removeTag(tagId);
     }
     
-    std::cout << "Successfully removed " << tagIds.size() << " duplicate tags" << std::endl;
+    logInfo() << "Successfully removed " << tagIds.size() << " duplicate tags" << std::endl;
     return true;
 }
 
-std::string RootsMagicSync::formatPersonName(const PersonRecord& person)
+std::vector<StatementCache::Statistics> RootsMagicSync::statementStatistics() const
 {
-    std::string birthYearStr = (person.birthYear == 0) ? "unknown" : std::to_string(person.birthYear);
-    std::string deathYearStr = (person.deathYear == 0) ? "unknown" : std::to_string(person.deathYear);
-    
-    return person.given + " " + person.surname + " " + birthYearStr + "-" + deathYearStr + " (OwnerID: " + std::to_string(person.ownerId) + ")";
+    std::vector<StatementCache::Statistics> stats;
+    for (const auto* cache : {m_rootsMagicStatements.get(), m_digiKamStatements.get()}) {
+        if (cache) {
+            auto cacheStats = cache->statistics();
+            stats.insert(stats.end(), cacheStats.begin(), cacheStats.end());
+        }
+    }
+    return stats;
 }
 
-std::string RootsMagicSync::formatFamilyTagName(const FamilyRecord& family)
+std::string_view RootsMagicSync::formatPersonName(const PersonRecord& person, StringArena& strings)
 {
-    std::string fatherFullName;
-    std::string motherFullName;
-    
-    // Format father's full name with OwnerID
-    if (family.fatherGiven.empty() && family.fatherSurname.empty() || family.fatherOwnerId == 0) {
-        fatherFullName = "unknown";
-    } else {
-        fatherFullName = family.fatherGiven + " " + family.fatherSurname + " (OwnerID: " + std::to_string(family.fatherOwnerId) + ")";
-    }
-    
-    // Format mother's full name with OwnerID
-    if (family.motherGiven.empty() && family.motherSurname.empty() || family.motherOwnerId == 0) {
-        motherFullName = "unknown";
-    } else {
-        motherFullName = family.motherGiven + " " + family.motherSurname + " (OwnerID: " + std::to_string(family.motherOwnerId) + ")";
-    }
-    
-    return fatherFullName + " and " + motherFullName + " Family (FamilyID: " + std::to_string(family.familyId) + ")";
+    // Rendered into a buffer reused across calls, so only the finished name is copied
+    thread_local std::string name;
+    name.clear();
+    m_personFormat.render(person, name);
+    return strings.store(name);
+}
+
+std::string_view RootsMagicSync::formatFamilyTagName(const FamilyRecord& family, StringArena& strings)
+{
+    thread_local std::string name;
+    name.clear();
+    m_familyFormat.render(family, name);
+    return strings.store(name);
+}
+
+std::string_view RootsMagicSync::columnView(sqlite3_stmt* stmt, int column)
+{
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+    return text ? std::string_view(text, sqlite3_column_bytes(stmt, column)) : std::string_view();
 }
 
 std::string RootsMagicSync::escapeSqlString(const std::string& str)
@@ -994,7 +1989,7 @@ bool RootsMagicSync::executeQuery(sqlite3* db, const std::string& query)
     int rc = sqlite3_exec(db, query.c_str(), nullptr, nullptr, &errMsg);
     
     if (rc != SQLITE_OK) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
+        logError() << "SQL error: " << errMsg << std::endl;
         sqlite3_free(errMsg);
         return false;
     }
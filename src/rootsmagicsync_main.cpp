@@ -1,6 +1,18 @@
 #include "rootsmagicsync.h"
+#include "dbbackup.h"
+#ifdef HAVE_HEAP_STATS
+#include "heapstats.h"
+#endif
+#include "logger.h"
+#include "syncwatch.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <set>
 #include <string>
+#include <vector>
 
 void printUsage(const char* programName) {
     std::cout << "RootsMagic to DigiKam Tag Synchronization Tool\n"
@@ -9,40 +21,233 @@ void printUsage(const char* programName) {
               << "  -r, --rootsmagic     Path to RootsMagic database file (.rmgc or .rmtree)\n"
               << "  -d, --digikam        Path to DigiKam database file (digikam4.db)\n"
               << "  -p, --parent-tag     Parent tag name for RootsMagic tags (default: RootsMagic)\n"
+              << "                       Repeat -r and -p to sync several trees; the Nth -p goes with the Nth -r\n"
+              << "      --jobs FILE      Sync the trees listed in FILE, one \"<rootsmagic_db> | <parent tag>\" per line\n"
               << "  -l, --lost-found     Lost & Found tag name for orphaned tags (default: Lost & Found)\n"
+              << "      --backup         Back up the DigiKam database before changing it\n"
+              << "      --backup-dir D   Directory for backups, implies --backup (default: next to the database)\n"
+              << "      --keep-backups N Number of backups to keep, implies --backup (default: 5)\n"
+              << "      --compress-backup\n"
+              << "                       gzip the backup, implies --backup\n"
+              << "      --restore FILE   Restore the DigiKam database from a backup and exit (no -r needed)\n"
+              << "  -s, --statement-stats Print how often each cached SQL statement was executed\n"
+              << "  -m, --memory-stats   Print peak memory use, and heap allocation counts in\n"
+              << "                       builds with -DRMS_HEAP_STATS=ON\n"
+              << "  -q, --quiet          Only print warnings and errors\n"
+              << "  -v, --verbose        Also print every tag created, renamed, moved or rescued\n"
+              << "      --metrics-json F Write phase timings and counters to F as JSON\n"
+              << "  -b, --bulk           Create new tags in set-based batches (faster initial syncs)\n"
+              << "      --batch-size N   Rows per batch in bulk mode (default: 1000)\n"
+              << "  -i, --incremental    Only process people changed since the last sync (RootsMagic 8+)\n"
+              << "      --serial-load    Load RootsMagic and DigiKam data one after another\n"
+              << "      --profile P      SQLite settings: safe, fast or bulk (default: safe)\n"
+              << "      --owner-index    Add an index on TagProperties for owner and family id lookups\n"
+              << "      --stream         Sync in OwnerID chunks with bounded memory (no incremental)\n"
+              << "      --watch          Keep running and resync incrementally whenever the RootsMagic file changes\n"
+              << "      --debounce-ms N  Quiet time after the last RootsMagic write before resyncing (default: 2000)\n"
+              << "      --memory-limit-mb N\n"
+              << "                       Memory ceiling in MB for --stream, implies it (default: 64)\n"
+              << "      --person-format T\n"
+              << "                       Person tag name template\n"
+              << "                       (default: {given} {surname} {birth}-{death} (OwnerID: {id}))\n"
+              << "      --family-format T\n"
+              << "                       Family tag name template\n"
+              << "                       (default: {father} and {mother} Family (FamilyID: {id}))\n"
               << "  -h, --help           Show this help message\n\n"
               << "Examples:\n"
               << "  " << programName << " -r \"C:\\Family\\Kennedy.rmtree\" -d \"C:\\Users\\User\\AppData\\Local\\digikam\\digikam4.db\"\n"
-              << "  " << programName << " -r family.rmgc -d digikam4.db -p \"Family Tree\" -l \"Orphaned Tags\"\n\n"
+              << "  " << programName << " -r family.rmgc -d digikam4.db -p \"Family Tree\" -l \"Orphaned Tags\"\n"
+              << "  " << programName << " -r Huskey.rmtree -p Huskey -r Kennedy.rmtree -p Kennedy -d digikam4.db\n\n"
               << "IMPORTANT:\n"
               << "  - Close DigiKam completely before running this tool\n"
-              << "  - This tool will create backup tables and can restore on error\n"
+              << "  - All changes are made in one transaction and rolled back on error\n"
+              << "  - Use --backup to keep snapshots of digikam4.db and --restore to go back to one\n"
               << "  - Existing photo tag associations will be preserved\n"
               << "  - Tags are synchronized based on RootsMagic OwnerID, not names\n";
 }
 
+// Reads "<rootsmagic_db> | <parent tag>" lines; the tag may be left out, and
+// blank lines and lines starting with # are skipped
+bool readJobFile(const std::string& path, std::vector<SyncJob>& jobs)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Error: cannot read job file " << path << "\n";
+        return false;
+    }
+
+    auto trim = [](std::string text) {
+        size_t first = text.find_first_not_of(" \t\r");
+        size_t last = text.find_last_not_of(" \t\r");
+        return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+    };
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        SyncJob job;
+        size_t separator = line.find('|');
+        job.rootsMagicPath = trim(line.substr(0, separator));
+        if (separator != std::string::npos) {
+            job.parentTagName = trim(line.substr(separator + 1));
+        }
+        if (job.rootsMagicPath.empty() || job.parentTagName.empty()) {
+            std::cerr << "Error: malformed line in job file " << path << ": " << line << "\n";
+            return false;
+        }
+        jobs.push_back(std::move(job));
+    }
+    return true;
+}
+
 int main(int argc, char* argv[])
 {
-    std::string rootsMagicDbPath;
+    std::vector<std::string> rootsMagicDbPaths;
+    std::vector<std::string> parentTags;
+    std::vector<SyncJob> jobs;
     std::string digiKamDbPath;
-    std::string parentTag = "RootsMagic";
     std::string lostFoundTag = "Lost & Found";
+    bool backup = false;
+    BackupOptions backupOptions;
+    std::string restorePath;
+    bool showStatementStats = false;
+    bool showMemoryStats = false;
+    std::string metricsPath;
+    bool bulkApply = false;
+    int batchSize = 1000;
+    bool incremental = false;
+    bool serialLoad = false;
+    ConnectionProfile connectionProfile = ConnectionProfile::Safe;
+    bool ownerIndex = false;
+    bool streaming = false;
+    bool watch = false;
+    WatchOptions watchOptions;
+    int memoryLimitMb = 64;
+    LogLevel logLevel = LogLevel::Info;
+    std::string personFormat = NameFormat::kDefaultPersonFormat;
+    std::string familyFormat = NameFormat::kDefaultFamilyFormat;
 
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
         if ((arg == "-r" || arg == "--rootsmagic") && i + 1 < argc) {
-            rootsMagicDbPath = argv[++i];
+            rootsMagicDbPaths.push_back(argv[++i]);
         }
         else if ((arg == "-d" || arg == "--digikam") && i + 1 < argc) {
             digiKamDbPath = argv[++i];
         }
         else if ((arg == "-p" || arg == "--parent-tag") && i + 1 < argc) {
-            parentTag = argv[++i];
+            parentTags.push_back(argv[++i]);
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            if (!readJobFile(argv[++i], jobs)) {
+                return 1;
+            }
         }
         else if ((arg == "-l" || arg == "--lost-found") && i + 1 < argc) {
             lostFoundTag = argv[++i];
         }
+        else if (arg == "--backup") {
+            backup = true;
+        }
+        else if (arg == "--backup-dir" && i + 1 < argc) {
+            backupOptions.directory = argv[++i];
+            backup = true;
+        }
+        else if (arg == "--keep-backups" && i + 1 < argc) {
+            backupOptions.keep = std::atoi(argv[++i]);
+            if (backupOptions.keep <= 0) {
+                std::cerr << "Error: --keep-backups must be a positive number\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+            backup = true;
+        }
+        else if (arg == "--compress-backup") {
+            if (!backupCompressionAvailable()) {
+                std::cerr << "Error: --compress-backup needs a build with zlib\n\n";
+                return 1;
+            }
+            backupOptions.compress = true;
+            backup = true;
+        }
+        else if (arg == "--restore" && i + 1 < argc) {
+            restorePath = argv[++i];
+        }
+        else if (arg == "-s" || arg == "--statement-stats") {
+            showStatementStats = true;
+        }
+        else if (arg == "-m" || arg == "--memory-stats") {
+            showMemoryStats = true;
+        }
+        else if (arg == "-q" || arg == "--quiet") {
+            logLevel = LogLevel::Warning;
+        }
+        else if (arg == "-v" || arg == "--verbose") {
+            logLevel = LogLevel::Debug;
+        }
+        else if (arg == "--metrics-json" && i + 1 < argc) {
+            metricsPath = argv[++i];
+        }
+        else if (arg == "-b" || arg == "--bulk") {
+            bulkApply = true;
+        }
+        else if (arg == "--batch-size" && i + 1 < argc) {
+            batchSize = std::atoi(argv[++i]);
+            if (batchSize <= 0) {
+                std::cerr << "Error: --batch-size must be a positive number\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "-i" || arg == "--incremental") {
+            incremental = true;
+        }
+        else if (arg == "--serial-load") {
+            serialLoad = true;
+        }
+        else if (arg == "--profile" && i + 1 < argc) {
+            if (!parseConnectionProfile(argv[++i], connectionProfile)) {
+                std::cerr << "Error: --profile must be safe, fast or bulk\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--owner-index") {
+            ownerIndex = true;
+        }
+        else if (arg == "--watch") {
+            watch = true;
+        }
+        else if (arg == "--debounce-ms" && i + 1 < argc) {
+            int debounceMs = std::atoi(argv[++i]);
+            if (debounceMs < 0) {
+                std::cerr << "Error: --debounce-ms must not be negative\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+            watchOptions.debounce = std::chrono::milliseconds(debounceMs);
+        }
+        else if (arg == "--stream") {
+            streaming = true;
+        }
+        else if (arg == "--memory-limit-mb" && i + 1 < argc) {
+            memoryLimitMb = std::atoi(argv[++i]);
+            if (memoryLimitMb <= 0) {
+                std::cerr << "Error: --memory-limit-mb must be a positive number\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+            streaming = true;
+        }
+        else if (arg == "--person-format" && i + 1 < argc) {
+            personFormat = argv[++i];
+        }
+        else if (arg == "--family-format" && i + 1 < argc) {
+            familyFormat = argv[++i];
+        }
         else if (arg == "-h" || arg == "--help") {
             printUsage(argv[0]);
             return 0;
@@ -54,49 +259,164 @@ int main(int argc, char* argv[])
         }
     }
 
+    // Pair the -r and -p options up, ahead of the job file's trees
+    if (parentTags.size() > std::max<size_t>(rootsMagicDbPaths.size(), 1)) {
+        std::cerr << "Error: more parent tags (-p) than RootsMagic databases (-r)\n\n";
+        printUsage(argv[0]);
+        return 1;
+    }
+    for (size_t i = 0; i < rootsMagicDbPaths.size(); i++) {
+        SyncJob job;
+        job.rootsMagicPath = rootsMagicDbPaths[i];
+        if (i < parentTags.size()) {
+            job.parentTagName = parentTags[i];
+        }
+        jobs.insert(jobs.begin() + static_cast<std::ptrdiff_t>(i), std::move(job));
+    }
+
     // Validate required arguments
-    if (rootsMagicDbPath.empty()) {
+    if (jobs.empty() && restorePath.empty()) {
         std::cerr << "Error: RootsMagic database path is required (-r)\n\n";
         printUsage(argv[0]);
         return 1;
     }
 
+    // Two trees under one parent tag would move each other's people to Lost & Found
+    std::set<std::string> seenParentTags;
+    for (const SyncJob& job : jobs) {
+        if (!seenParentTags.insert(job.parentTagName).second) {
+            std::cerr << "Error: parent tag \"" << job.parentTagName << "\" is used by more than one RootsMagic database; "
+                      << "give each one its own with -p\n\n";
+            return 1;
+        }
+    }
+
     if (digiKamDbPath.empty()) {
         std::cerr << "Error: DigiKam database path is required (-d)\n\n";
         printUsage(argv[0]);
         return 1;
     }
 
+    if (watch && jobs.size() != 1) {
+        std::cerr << "Error: --watch syncs a single RootsMagic database\n\n";
+        return 1;
+    }
+    if (watch && connectionProfile == ConnectionProfile::Bulk) {
+        // Bulk opens RootsMagic as immutable, so changes would never be read
+        std::cerr << "Error: --watch cannot be combined with --profile bulk\n\n";
+        return 1;
+    }
+
+    Logger::instance().setLevel(logLevel);
+
+    if (!restorePath.empty()) {
+        if (!restoreDatabase(restorePath, digiKamDbPath)) {
+            logError() << "Restore failed" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     // Display configuration
-    std::cout << "RootsMagic to DigiKam Tag Synchronization\n";
-    std::cout << "========================================\n";
-    std::cout << "RootsMagic Database: " << rootsMagicDbPath << "\n";
-    std::cout << "DigiKam Database:    " << digiKamDbPath << "\n";
-    std::cout << "Parent Tag:          " << parentTag << "\n";
-    std::cout << "Lost & Found Tag:    " << lostFoundTag << "\n\n";
+    logInfo() << "RootsMagic to DigiKam Tag Synchronization\n";
+    logInfo() << "========================================\n";
+    if (jobs.size() == 1) {
+        logInfo() << "RootsMagic Database: " << jobs.front().rootsMagicPath << "\n";
+        logInfo() << "DigiKam Database:    " << digiKamDbPath << "\n";
+        logInfo() << "Parent Tag:          " << jobs.front().parentTagName << "\n";
+    } else {
+        for (const SyncJob& job : jobs) {
+            logInfo() << "RootsMagic Database: " << job.rootsMagicPath << " -> " << job.parentTagName << "\n";
+        }
+        logInfo() << "DigiKam Database:    " << digiKamDbPath << "\n";
+    }
+    logInfo() << "Lost & Found Tag:    " << lostFoundTag << "\n";
+    logInfo() << "SQLite Profile:      " << connectionProfileName(connectionProfile) << "\n\n";
+
+    // Snapshot before anything is written; no sync without it when one was asked for
+    std::string backupPath;
+    if (backup && !backupDatabase(digiKamDbPath, backupOptions, backupPath)) {
+        logError() << "Backup failed, DigiKam database left unchanged" << std::endl;
+        return 1;
+    }
 
     // Create and configure the sync tool
     RootsMagicSync sync;
+    sync.setBulkApply(bulkApply, batchSize);
+    sync.setIncremental(incremental || watch);
+    sync.setConcurrentLoad(!serialLoad);
+    sync.setConnectionProfile(connectionProfile);
+    sync.setOwnerIndex(ownerIndex);
+    sync.setStreaming(streaming, memoryLimitMb);
+    if (!sync.setNameFormats(personFormat, familyFormat)) {
+        return 1;
+    }
 
-    // Connect to databases
-    if (!sync.connectToRootsMagicDatabase(rootsMagicDbPath)) {
-        std::cerr << "Failed to connect to RootsMagic database" << std::endl;
+    // Connect to databases; a batch connects to each RootsMagic file as it gets to it
+    if (jobs.size() == 1 && !sync.connectToRootsMagicDatabase(jobs.front().rootsMagicPath)) {
+        logError() << "Failed to connect to RootsMagic database" << std::endl;
         return 1;
     }
 
     if (!sync.connectToDigiKamDatabase(digiKamDbPath)) {
-        std::cerr << "Failed to connect to DigiKam database" << std::endl;
+        logError() << "Failed to connect to DigiKam database" << std::endl;
         return 1;
     }
 
+    if (watch) {
+        watchOptions.metricsPath = metricsPath;
+        if (!watchAndSynchronize(sync, jobs.front().rootsMagicPath, jobs.front().parentTagName, lostFoundTag, watchOptions)) {
+            logError() << "Synchronization failed" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     // Perform synchronization
-    if (!sync.synchronizeTags(parentTag, lostFoundTag)) {
-        std::cerr << "Synchronization failed" << std::endl;
+    bool synchronized = jobs.size() == 1 ? sync.synchronizeTags(jobs.front().parentTagName, lostFoundTag)
+                                         : sync.synchronizeBatch(jobs, lostFoundTag);
+
+    // Failed runs are reported too, so dashboards see them
+    if (!metricsPath.empty() && !sync.metrics().writeJson(metricsPath)) {
+        logWarning() << "Warning: Failed to write metrics to " << metricsPath << std::endl;
+    }
+
+    if (!synchronized) {
+        logError() << (jobs.size() == 1 ? "Synchronization failed" : "Synchronization failed for at least one tree") << std::endl;
         return 1;
     }
 
-    std::cout << "\nSynchronization completed successfully!" << std::endl;
-    std::cout << "You can now start DigiKam to see the updated tags." << std::endl;
+    // Statistics were asked for explicitly, so they are printed whatever the log level
+    if (showStatementStats) {
+        std::cout << "\nPrepared statement usage:" << std::endl;
+        for (const auto& stat : sync.statementStatistics()) {
+            // Collapse the raw-string indentation so each statement fits on one line
+            std::string sql;
+            bool lastWasSpace = false;
+            for (char c : stat.sql) {
+                bool isSpace = std::isspace(static_cast<unsigned char>(c)) != 0;
+                if (isSpace && (lastWasSpace || sql.empty())) continue;
+                sql += isSpace ? ' ' : c;
+                lastWasSpace = isSpace;
+            }
+            std::cout << "  " << stat.hits << "x  " << sql << std::endl;
+        }
+    }
+
+    if (showMemoryStats) {
+        std::cout << "\nMemory usage:" << std::endl;
+#ifdef HAVE_HEAP_STATS
+        HeapStatistics heap = heapStatistics();
+        std::cout << "  Heap allocations: " << heap.allocations << std::endl;
+        std::cout << "  Peak heap: " << heap.peakBytes / 1024 << " KB" << std::endl;
+#endif
+        std::cout << "  Peak resident memory: " << sync.metrics().peakResidentBytes() / 1024 << " KB" << std::endl;
+        std::cout << "  Record text: " << sync.stringBytesStored() / 1024 << " KB" << std::endl;
+    }
+
+    logInfo() << "\nSynchronization completed successfully!" << std::endl;
+    logInfo() << "You can now start DigiKam to see the updated tags." << std::endl;
+    Logger::instance().flush();
     
     return 0;
 }
@@ -0,0 +1,73 @@
+#include "statementcache.h"
+#include <algorithm>
+
+StatementCache::StatementCache(sqlite3* db)
+    : m_db(db)
+{
+}
+
+StatementCache::~StatementCache()
+{
+    clear();
+}
+
+sqlite3_stmt* StatementCache::acquire(std::string_view sql)
+{
+    auto it = m_statements.find(sql);
+    if (it != m_statements.end()) {
+        Entry& entry = *it->second;
+        sqlite3_reset(entry.stmt);
+        sqlite3_clear_bindings(entry.stmt);
+        entry.hits++;
+        return entry.stmt;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->sql = std::string(sql);
+    entry->hits = 1;
+    entry->stmt = nullptr;
+
+    int rc = sqlite3_prepare_v3(m_db, entry->sql.c_str(), static_cast<int>(entry->sql.size()),
+                                SQLITE_PREPARE_PERSISTENT, &entry->stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        sqlite3_finalize(entry->stmt);
+        return nullptr;
+    }
+
+    sqlite3_stmt* stmt = entry->stmt;
+    std::string_view key = entry->sql;
+    m_statements.emplace(key, std::move(entry));
+    return stmt;
+}
+
+void StatementCache::clear()
+{
+    for (auto& [sql, entry] : m_statements) {
+        sqlite3_finalize(entry->stmt);
+    }
+    m_statements.clear();
+}
+
+std::vector<StatementCache::Statistics> StatementCache::statistics() const
+{
+    std::vector<Statistics> stats;
+    stats.reserve(m_statements.size());
+    for (const auto& [sql, entry] : m_statements) {
+        stats.push_back({entry->sql, entry->hits});
+    }
+
+    // Busiest statements first
+    std::sort(stats.begin(), stats.end(), [](const Statistics& a, const Statistics& b) {
+        return a.hits > b.hits;
+    });
+    return stats;
+}
+
+int StatementCache::totalHits() const
+{
+    int total = 0;
+    for (const auto& [sql, entry] : m_statements) {
+        total += entry->hits;
+    }
+    return total;
+}
@@ -0,0 +1,49 @@
+#include "stringarena.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+StringArena::StringArena(size_t blockSize)
+    : m_blockSize(blockSize), m_cursor(nullptr), m_remaining(0), m_bytesStored(0)
+{
+}
+
+std::string_view StringArena::store(std::string_view text)
+{
+    if (text.empty()) {
+        return std::string_view();
+    }
+
+    if (text.size() > m_remaining) {
+        // Oversized strings get a block of their own
+        size_t size = std::max(m_blockSize, text.size());
+        m_blocks.push_back(std::make_unique<char[]>(size));
+        m_cursor = m_blocks.back().get();
+        m_remaining = size;
+    }
+
+    char* copy = m_cursor;
+    std::memcpy(copy, text.data(), text.size());
+    m_cursor += text.size();
+    m_remaining -= text.size();
+    m_bytesStored += text.size();
+    return std::string_view(copy, text.size());
+}
+
+void StringArena::absorb(StringArena&& other)
+{
+    // New strings keep going into this arena's current block
+    m_blocks.insert(m_blocks.end(),
+                    std::make_move_iterator(other.m_blocks.begin()),
+                    std::make_move_iterator(other.m_blocks.end()));
+    m_bytesStored += other.m_bytesStored;
+    other.clear();
+}
+
+void StringArena::clear()
+{
+    m_blocks.clear();
+    m_cursor = nullptr;
+    m_remaining = 0;
+    m_bytesStored = 0;
+}
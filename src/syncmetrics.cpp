@@ -0,0 +1,287 @@
+#include "syncmetrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+size_t currentPeakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);  // Already bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+std::string jsonString(const std::string& text)
+{
+    std::string result = "\"";
+    for (char c : text) {
+        switch (c) {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                result += escaped;
+            } else {
+                result += c;
+            }
+        }
+    }
+    return result + "\"";
+}
+
+std::string jsonNumber(double value)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.3f", value);
+    return text;
+}
+
+}
+
+const char* syncPhaseName(SyncPhase phase)
+{
+    switch (phase) {
+    case SyncPhase::RootsMagicLoad: return "rootsmagic_load";
+    case SyncPhase::FamilyLoad: return "family_load";
+    case SyncPhase::DigiKamLoad: return "digikam_load";
+    case SyncPhase::Planning: return "planning";
+    case SyncPhase::DuplicateCleanup: return "duplicate_cleanup";
+    case SyncPhase::FamilyTags: return "family_tags";
+    case SyncPhase::FamilyParenting: return "family_parenting";
+    case SyncPhase::PersonSync: return "person_sync";
+    case SyncPhase::PostRescueCleanup: return "post_rescue_cleanup";
+    case SyncPhase::OrphanMove: return "orphan_move";
+    case SyncPhase::Commit: return "commit";
+    default: return "unknown";
+    }
+}
+
+SyncMetrics::SyncMetrics()
+    : m_statementsExecuted(0), m_bytesRead(0), m_rowsWritten(0), m_totalMilliseconds(0), m_success(false),
+      m_bulkApply(false), m_people(0),
+      m_tagsCreated(0), m_tagsUpdated(0), m_tagsOrphaned(0), m_tagsRescued(0), m_peakResidentBytes(0),
+      m_changeLatencyMilliseconds(-1)
+{
+    m_phases.fill({0.0, 0});
+}
+
+void SyncMetrics::start()
+{
+    m_phases.fill({0.0, 0});
+    m_statementsExecuted = 0;
+    m_bytesRead = 0;
+    m_startedAt = std::chrono::system_clock::now();
+    m_startClock = std::chrono::steady_clock::now();
+    m_totalMilliseconds = 0;
+    m_success = false;
+    m_people = 0;
+    m_rowsWritten = 0;
+    m_tagsCreated = m_tagsUpdated = m_tagsOrphaned = m_tagsRescued = 0;
+    m_peakResidentBytes = 0;
+    m_changeLatencyMilliseconds = -1;
+
+    // Reads before the run started are not part of it
+    std::lock_guard<std::mutex> lock(m_connectionsMutex);
+    for (const auto& [db, pageSize] : m_connections) {
+        int current = 0;
+        int highwater = 0;
+        sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 1);
+    }
+}
+
+void SyncMetrics::finish(bool success)
+{
+    m_totalMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startClock).count();
+    m_success = success;
+    {
+        std::lock_guard<std::mutex> lock(m_connectionsMutex);
+        for (const auto& [db, pageSize] : m_connections) {
+            collectReads(db, pageSize);
+        }
+    }
+    m_peakResidentBytes = currentPeakResidentBytes();
+}
+
+void SyncMetrics::addPhase(SyncPhase phase, double milliseconds, long long rows)
+{
+    Phase& entry = m_phases[static_cast<size_t>(phase)];
+    entry.milliseconds += milliseconds;
+    entry.rows += rows;
+}
+
+void SyncMetrics::attach(sqlite3* db)
+{
+    // Page size is read before tracing starts so the query isn't counted
+    int pageSize = 4096;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "PRAGMA page_size", -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        pageSize = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    int current = 0;
+    int highwater = 0;
+    sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 1);
+
+    sqlite3_trace_v2(db, SQLITE_TRACE_STMT, &SyncMetrics::traceStatement, this);
+    sqlite3_update_hook(db, &SyncMetrics::countRowWritten, this);
+
+    std::lock_guard<std::mutex> lock(m_connectionsMutex);
+    m_connections.emplace_back(db, pageSize);
+}
+
+void SyncMetrics::detach(sqlite3* db)
+{
+    sqlite3_trace_v2(db, 0, nullptr, nullptr);
+    sqlite3_update_hook(db, nullptr, nullptr);
+
+    std::lock_guard<std::mutex> lock(m_connectionsMutex);
+    auto it = std::find_if(m_connections.begin(), m_connections.end(),
+                           [db](const auto& connection) { return connection.first == db; });
+    if (it != m_connections.end()) {
+        collectReads(db, it->second);
+        m_connections.erase(it);
+    }
+}
+
+void SyncMetrics::collectReads(sqlite3* db, int pageSize)
+{
+    int misses = 0;
+    int highwater = 0;
+    if (sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &misses, &highwater, 1) == SQLITE_OK) {
+        m_bytesRead += static_cast<long long>(misses) * pageSize;
+    }
+}
+
+int SyncMetrics::traceStatement(unsigned type, void* context, void*, void* sql)
+{
+    // Statements inside trigger bodies are reported as "-- TRIGGER name"
+    const char* text = static_cast<const char*>(sql);
+    if (type == SQLITE_TRACE_STMT && !(text && text[0] == '-' && text[1] == '-')) {
+        static_cast<SyncMetrics*>(context)->m_statementsExecuted++;
+    }
+    return 0;
+}
+
+void SyncMetrics::countRowWritten(void* context, int, const char* database, const char* table, sqlite3_int64)
+{
+    // Called for every row, also those written by triggers and to TEMP tables
+    if (std::strcmp(database, "main") == 0 &&
+        (std::strcmp(table, "Tags") == 0 || std::strcmp(table, "TagProperties") == 0 ||
+         std::strcmp(table, "ImageTags") == 0)) {
+        static_cast<SyncMetrics*>(context)->m_rowsWritten++;
+    }
+}
+
+void SyncMetrics::setMode(const std::string& mode, bool bulkApply)
+{
+    m_mode = mode;
+    m_bulkApply = bulkApply;
+}
+
+void SyncMetrics::setConnectionProfile(const std::string& profile, const std::string& journalMode)
+{
+    m_connectionProfile = profile;
+    m_journalMode = journalMode;
+}
+
+void SyncMetrics::setTagCounts(int created, int updated, int orphaned, int rescued)
+{
+    m_tagsCreated = created;
+    m_tagsUpdated = updated;
+    m_tagsOrphaned = orphaned;
+    m_tagsRescued = rescued;
+}
+
+bool SyncMetrics::writeJson(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    std::time_t startedAt = std::chrono::system_clock::to_time_t(m_startedAt);
+    char timestamp[32] = "";
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&startedAt));
+
+    out << "{\n";
+    out << "  \"started_at\": " << jsonString(timestamp) << ",\n";
+    out << "  \"success\": " << (m_success ? "true" : "false") << ",\n";
+    out << "  \"mode\": " << jsonString(m_mode) << ",\n";
+    out << "  \"bulk\": " << (m_bulkApply ? "true" : "false") << ",\n";
+    out << "  \"profile\": " << jsonString(m_connectionProfile) << ",\n";
+    out << "  \"journal_mode\": " << jsonString(m_journalMode) << ",\n";
+    out << "  \"total_ms\": " << jsonNumber(m_totalMilliseconds) << ",\n";
+    out << "  \"change_latency_ms\": "
+        << (m_changeLatencyMilliseconds >= 0 ? jsonNumber(m_changeLatencyMilliseconds) : std::string("null")) << ",\n";
+    out << "  \"phases\": {\n";
+    for (size_t i = 0; i < m_phases.size(); i++) {
+        out << "    " << jsonString(syncPhaseName(static_cast<SyncPhase>(i)))
+            << ": {\"ms\": " << jsonNumber(m_phases[i].milliseconds)
+            << ", \"rows\": " << m_phases[i].rows << "}"
+            << (i + 1 < m_phases.size() ? "," : "") << "\n";
+    }
+    out << "  },\n";
+    out << "  \"people\": " << m_people << ",\n";
+    out << "  \"tags_created\": " << m_tagsCreated << ",\n";
+    out << "  \"tags_updated\": " << m_tagsUpdated << ",\n";
+    out << "  \"tags_orphaned\": " << m_tagsOrphaned << ",\n";
+    out << "  \"tags_rescued\": " << m_tagsRescued << ",\n";
+    out << "  \"sql_statements\": " << m_statementsExecuted.load() << ",\n";
+    out << "  \"rows_written\": " << m_rowsWritten << ",\n";
+    out << "  \"bytes_read\": " << m_bytesRead.load() << ",\n";
+    out << "  \"peak_rss_bytes\": " << m_peakResidentBytes << "\n";
+    out << "}\n";
+    return static_cast<bool>(out.flush());
+}
+
+PhaseTimer::PhaseTimer(SyncMetrics& metrics, SyncPhase phase, bool countWrites)
+    : m_metrics(metrics), m_phase(phase), m_countWrites(countWrites),
+      m_rowsWrittenAtStart(countWrites ? metrics.rowsWritten() : 0), m_rows(0),
+      m_start(std::chrono::steady_clock::now())
+{
+}
+
+PhaseTimer::~PhaseTimer()
+{
+    if (m_countWrites) {
+        m_rows = m_metrics.rowsWritten() - m_rowsWrittenAtStart;
+    }
+    m_metrics.addPhase(m_phase, elapsedMilliseconds(), m_rows);
+}
+
+double PhaseTimer::elapsedMilliseconds() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
@@ -0,0 +1,65 @@
+#include "syncplan.h"
+
+SyncPlan buildSyncPlan(const std::vector<PersonRecord>& people,
+                       const IdTable<FamilyRecord>& families,
+                       const IdTable<DigiKamTag>& existingTags,
+                       const IdTable<DigiKamTag>& lostFoundTags,
+                       const IdSet* liveOwnerIds)
+{
+    SyncPlan plan;
+
+    // A person present in both trees keeps the main tag; the Lost & Found copy goes
+    lostFoundTags.forEach([&](int ownerId, const DigiKamTag& lostTag) {
+        if (existingTags.contains(ownerId)) {
+            plan.duplicateDeletes.push_back(&lostTag);
+        }
+    });
+
+    IdSet rmOwnerIds;
+    IdSet referencedFamilies;
+    rmOwnerIds.reserve(people.size());
+
+    for (const auto& person : people) {
+        rmOwnerIds.insert(person.ownerId);
+
+        const FamilyRecord* family = nullptr;
+        if (person.familyId > 0) {
+            family = families.find(person.familyId);
+            if (family && referencedFamilies.insert(family->familyId)) {
+                plan.familyTags.push_back(family);
+            }
+        }
+
+        if (const DigiKamTag* tag = existingTags.find(person.ownerId)) {
+            // Family tags may not exist yet, so whether the tag moves is settled when applying
+            if (family) {
+                plan.reparents.push_back({tag, &person, family});
+            }
+            if (tag->name != person.formattedName) {
+                plan.renames.push_back({tag, &person});
+            }
+            continue;
+        }
+
+        if (const DigiKamTag* lostTag = lostFoundTags.find(person.ownerId)) {
+            plan.rescues.push_back({lostTag, &person});
+        } else {
+            plan.creates.push_back(&person);
+        }
+    }
+
+    families.forEach([&](int familyId, const FamilyRecord& family) {
+        if (!referencedFamilies.contains(familyId)) {
+            plan.familyRefreshes.push_back(&family);
+        }
+    });
+
+    const IdSet& knownOwnerIds = liveOwnerIds ? *liveOwnerIds : rmOwnerIds;
+    existingTags.forEach([&](int ownerId, const DigiKamTag& tag) {
+        if (!knownOwnerIds.contains(ownerId)) {
+            plan.orphanMoves.push_back(&tag);
+        }
+    });
+
+    return plan;
+}
@@ -0,0 +1,131 @@
+#include "syncwatch.h"
+#include "filewatcher.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <thread>
+
+namespace {
+
+std::atomic<bool> g_stopRequested(false);
+
+extern "C" void requestStop(int)
+{
+    g_stopRequested = true;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Sleeps in short slices so Ctrl+C is not held up by a long backoff
+void sleepUnlessStopped(std::chrono::milliseconds duration)
+{
+    const std::chrono::milliseconds slice(200);
+    auto deadline = std::chrono::steady_clock::now() + duration;
+    while (!g_stopRequested && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::min(slice, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                        deadline - std::chrono::steady_clock::now())));
+    }
+}
+
+// Waits, doubling the wait each time, until DigiKam no longer holds a lock
+void waitWhileLocked(RootsMagicSync& sync, const WatchOptions& options)
+{
+    std::chrono::milliseconds backoff(1000);
+    while (!g_stopRequested && sync.isDigiKamLocked()) {
+        logWarning() << "Warning: DigiKam database is locked, retrying in " << backoff.count() / 1000.0 << " s" << std::endl;
+        sleepUnlessStopped(backoff);
+        backoff = std::min(backoff * 2, options.maxBackoff);
+    }
+}
+
+}
+
+bool watchAndSynchronize(RootsMagicSync& sync, const std::string& rootsMagicPath,
+                         const std::string& parentTagName, const std::string& lostFoundTagName,
+                         const WatchOptions& options)
+{
+    g_stopRequested = false;
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+
+    // Changes made while the first sync runs are picked up by the first wait
+    FileWatcher watcher(rootsMagicPath);
+    auto changedAt = std::chrono::steady_clock::now();
+    bool firstSync = true;
+    bool retryPending = false;
+    size_t resyncs = 0;
+    double totalLatency = 0;
+    double maxLatency = 0;
+
+    while (!g_stopRequested) {
+        if (!firstSync && !retryPending) {
+            if (!watcher.waitForChange(std::chrono::milliseconds(250))) {
+                continue;
+            }
+
+            // Writes come in bursts; wait for a quiet spell, but not forever
+            changedAt = std::chrono::steady_clock::now();
+            logInfo() << "RootsMagic file changed, waiting for writes to settle..." << std::endl;
+            Logger::instance().flush();
+            while (!g_stopRequested) {
+                auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - changedAt);
+                if (waited >= options.maxDelay ||
+                    !watcher.waitForChange(std::min(options.debounce, options.maxDelay - waited))) {
+                    break;
+                }
+            }
+        }
+
+        waitWhileLocked(sync, options);
+        if (g_stopRequested) {
+            break;
+        }
+
+        bool synchronized = sync.synchronizeTags(parentTagName, lostFoundTagName);
+        double latency = millisecondsSince(changedAt);
+        if (!firstSync) {
+            sync.metrics().setChangeLatency(latency);
+        }
+        if (!options.metricsPath.empty() && !sync.metrics().writeJson(options.metricsPath)) {
+            logWarning() << "Warning: Failed to write metrics to " << options.metricsPath << std::endl;
+        }
+
+        if (firstSync && !synchronized) {
+            return false;
+        }
+
+        // A sync that lost a race for the lock is retried without waiting for another change
+        retryPending = !synchronized && sync.isDigiKamLocked();
+        if (synchronized && !firstSync) {
+            resyncs++;
+            totalLatency += latency;
+            maxLatency = std::max(maxLatency, latency);
+            logInfo() << "Resync " << resyncs << " finished " << static_cast<long long>(latency)
+                      << " ms after the change (sync " << static_cast<long long>(sync.metrics().totalMilliseconds())
+                      << " ms)" << std::endl;
+        } else if (!synchronized && !retryPending) {
+            logError() << "Resync failed; waiting for the next change" << std::endl;
+        }
+
+        firstSync = false;
+        if (!retryPending) {
+            logInfo() << "Watching " << rootsMagicPath << " for changes (" << watcher.mechanism()
+                      << "), Ctrl+C to stop..." << std::endl;
+        }
+        Logger::instance().flush();
+    }
+
+    logInfo() << "\nStopped watching after " << resyncs << " resyncs";
+    if (resyncs > 0) {
+        logInfo() << ", change to sync latency " << static_cast<long long>(totalLatency / resyncs)
+                  << " ms on average, " << static_cast<long long>(maxLatency) << " ms at most";
+    }
+    logInfo() << std::endl;
+    Logger::instance().flush();
+    return true;
+}
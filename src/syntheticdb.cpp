@@ -0,0 +1,523 @@
+#include "syntheticdb.h"
+#include "nameformat.h"
+#include "rmnocase.h"
+#include "rootsmagicsync.h"
+#include "statementcache.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// Roughly ordered from most to least common; picked with 1/rank weights
+const char* const kSurnames[] = {
+    "Smith", "Johnson", "Andersson", "Müller", "Williams", "Brown", "Johansson", "Schmidt",
+    "Jones", "Nilsson", "Schneider", "Miller", "Larsson", "Fischer", "Davis", "Olsson",
+    "Weber", "Wilson", "Persson", "Meyer", "Taylor", "Hansen", "Wagner", "Moore",
+    "Jensen", "Becker", "Anderson", "Pedersen", "Schulz", "Thomas", "Nielsen", "Hoffmann",
+    "Jackson", "Kristiansen", "Schäfer", "White", "Lindqvist", "Koch", "Harris", "Ångström",
+    "Bauer", "Martin", "Sørensen", "Richter", "Thompson", "Öberg", "Klein", "Huskey",
+    "Kennedy", "Wolf", "Kjærsgaard", "Schröder", "MacDonald", "Østergaard", "Neumann", "Van Der Berg",
+    "Lindström", "Schwarz", "O'Brien", "Weißmüller", "Åkesson", "Zimmermann", "Bergström", "Krüger"
+};
+
+const char* const kMaleGiven[] = {
+    "John", "William", "James", "Karl", "Johan", "Carl", "George", "Thomas",
+    "Erik", "Heinrich", "Charles", "Lars", "Friedrich", "Henry", "Nils", "Wilhelm",
+    "Joseph", "Anders", "Hans", "Robert", "Per", "Jörg", "David", "Sven",
+    "Günther", "Samuel", "Søren", "Björn", "Karl-Heinz", "Øystein", "Ægir", "Jürgen"
+};
+
+const char* const kFemaleGiven[] = {
+    "Mary", "Anna", "Elizabeth", "Maria", "Sarah", "Margaret", "Kristina", "Catherine",
+    "Johanna", "Emma", "Edith", "Ingrid", "Elisabeth", "Martha", "Karin", "Hannah",
+    "Sophie", "Britta", "Helen", "Greta", "Ruth", "Åsa", "Brigitte", "Sigrid",
+    "Margaretha", "Heike", "Dorothea", "Märta", "Solveig", "Liesel", "Astrid", "Grete"
+};
+
+// Number of children per family: 0 through 8
+const double kChildCountWeights[] = {10, 18, 24, 19, 12, 8, 5, 3, 1};
+
+const int kPoolLimit = 20000;
+
+struct Adult {
+    int ownerId;
+    int surname;
+    int birthYear;  // Actual year, even when the record leaves it unknown
+};
+
+bool execute(sqlite3* db, const char* sql)
+{
+    char* errorMessage = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &errorMessage) != SQLITE_OK) {
+        std::cerr << "SQL error: " << (errorMessage ? errorMessage : "unknown") << std::endl;
+        sqlite3_free(errorMessage);
+        return false;
+    }
+    return true;
+}
+
+sqlite3* createDatabase(const std::string& path)
+{
+    std::remove(path.c_str());
+
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "Failed to create " << path << ": " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    // Nothing to protect while generating; a failed run just leaves a file to delete
+    if (!execute(db, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF;")) {
+        sqlite3_close(db);
+        return nullptr;
+    }
+    return db;
+}
+
+bool step(sqlite3* db, sqlite3_stmt* stmt)
+{
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "Failed to write synthetic row: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string_view columnView(sqlite3_stmt* stmt, int column)
+{
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+    return text ? std::string_view(text, sqlite3_column_bytes(stmt, column)) : std::string_view();
+}
+
+void bindText(sqlite3_stmt* stmt, int index, const char* text)
+{
+    sqlite3_bind_text(stmt, index, text, -1, SQLITE_STATIC);
+}
+
+class TreeWriter {
+public:
+    TreeWriter(sqlite3* db, const SyntheticTreeOptions& options)
+        : m_db(db), m_statements(db), m_options(options), m_random(options.seed),
+          m_surnames(makeSurnameDistribution()), m_nextOwnerId(1), m_nextNameId(1), m_nextFamilyId(1)
+    {
+    }
+
+    bool write()
+    {
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        std::discrete_distribution<int> childCount(std::begin(kChildCountWeights), std::end(kChildCountWeights));
+        std::uniform_int_distribution<int> firstBirthYear(1650, 1950);
+
+        while (hasRoom()) {
+            int familyId = m_nextFamilyId++;
+
+            // Parents are mostly grown children of earlier families, which links the generations
+            Adult father = {0, 0, 0};
+            Adult mother = {0, 0, 0};
+            if (chance(m_random) >= 0.05) {
+                if (!takeAdult(m_men, father) &&
+                    !addPerson(true, m_surnames(m_random), firstBirthYear(m_random), 0, father)) {
+                    return false;
+                }
+            }
+            if (chance(m_random) >= 0.10 || father.ownerId == 0) {
+                int birthYear = father.ownerId ? father.birthYear + std::uniform_int_distribution<int>(-8, 4)(m_random)
+                                               : firstBirthYear(m_random);
+                if (!takeAdult(m_women, mother) &&
+                    !addPerson(false, m_surnames(m_random), birthYear, 0, mother)) {
+                    return false;
+                }
+            }
+            if (father.ownerId == 0 && mother.ownerId == 0) {
+                break;
+            }
+
+            const Adult& lead = father.ownerId ? father : mother;
+            int parentBirthYear = std::max(father.birthYear, mother.birthYear);
+            int children = childCount(m_random);
+            int firstChild = 0;
+            for (int child = 0; child < children && hasRoom(); child++) {
+                int birthYear = parentBirthYear + std::uniform_int_distribution<int>(19, 42)(m_random);
+                bool male = chance(m_random) < 0.5;
+                Adult person;
+                if (!addPerson(male, lead.surname, birthYear, familyId, person) ||
+                    !addChild(person.ownerId, familyId, child + 1)) {
+                    return false;
+                }
+                if (firstChild == 0) firstChild = person.ownerId;
+
+                // Most children who reach adulthood before the present start a family
+                if (birthYear < 1995 && chance(m_random) < 0.75) {
+                    addToPool(male ? m_men : m_women, person);
+                }
+            }
+
+            if (!addFamily(familyId, father.ownerId, mother.ownerId, firstChild)) {
+                return false;
+            }
+
+            // A few people remarry and head a second family
+            if (father.ownerId && chance(m_random) < 0.04) addToPool(m_men, father);
+            if (mother.ownerId && chance(m_random) < 0.04) addToPool(m_women, mother);
+        }
+        return true;
+    }
+
+private:
+    static std::discrete_distribution<int> makeSurnameDistribution()
+    {
+        std::vector<double> weights;
+        for (size_t rank = 0; rank < std::size(kSurnames); rank++) {
+            weights.push_back(1.0 / (rank + 1));
+        }
+        return std::discrete_distribution<int>(weights.begin(), weights.end());
+    }
+
+    bool hasRoom() const { return static_cast<size_t>(m_nextOwnerId) <= m_options.people; }
+
+    bool takeAdult(std::vector<Adult>& pool, Adult& adult)
+    {
+        if (pool.empty() || std::uniform_real_distribution<double>(0.0, 1.0)(m_random) >= 0.6) {
+            return false;
+        }
+        size_t index = std::uniform_int_distribution<size_t>(0, pool.size() - 1)(m_random);
+        adult = pool[index];
+        pool[index] = pool.back();
+        pool.pop_back();
+        return true;
+    }
+
+    void addToPool(std::vector<Adult>& pool, const Adult& adult)
+    {
+        if (pool.size() < static_cast<size_t>(kPoolLimit)) {
+            pool.push_back(adult);
+        } else {
+            pool[std::uniform_int_distribution<size_t>(0, pool.size() - 1)(m_random)] = adult;
+        }
+    }
+
+    bool addPerson(bool male, int surname, int birthYear, int parentFamilyId, Adult& person)
+    {
+        if (!hasRoom()) {
+            person = {0, 0, 0};
+            return true;
+        }
+
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        int ownerId = m_nextOwnerId++;
+        const char* given = male ? kMaleGiven[m_random() % std::size(kMaleGiven)]
+                                 : kFemaleGiven[m_random() % std::size(kFemaleGiven)];
+        int deathYear = birthYear + std::uniform_int_distribution<int>(1, 95)(m_random);
+        bool living = deathYear > 2024;
+
+        // Records often lack one or both years
+        int recordedBirth = chance(m_random) < 0.10 ? 0 : birthYear;
+        int recordedDeath = (living || chance(m_random) < 0.15) ? 0 : deathYear;
+
+        const char* insertPersonSql = "INSERT INTO PersonTable (PersonID, Sex, ParentID, SpouseID, Living, UTCModDate) VALUES (?, ?, ?, 0, ?, ?)";
+        {
+            CachedStatement stmt(m_statements, insertPersonSql);
+            if (!stmt) return false;
+            sqlite3_bind_int(stmt, 1, ownerId);
+            sqlite3_bind_int(stmt, 2, male ? 0 : 1);
+            sqlite3_bind_int(stmt, 3, parentFamilyId);
+            sqlite3_bind_int(stmt, 4, living ? 1 : 0);
+            sqlite3_bind_double(stmt, 5, m_options.modificationDate);
+            if (!step(m_db, stmt)) return false;
+        }
+
+        if (!addName(ownerId, kSurnames[surname], given, 0, true, recordedBirth, recordedDeath)) {
+            return false;
+        }
+        if (chance(m_random) < m_options.alternateNameRate) {
+            // Married or alternate spelling of the surname
+            if (!addName(ownerId, kSurnames[m_surnames(m_random)], given, 5, false, recordedBirth, recordedDeath)) {
+                return false;
+            }
+        }
+
+        person = {ownerId, surname, birthYear};
+        return true;
+    }
+
+    bool addName(int ownerId, const char* surname, const char* given, int nameType, bool primary,
+                 int birthYear, int deathYear)
+    {
+        const char* insertNameSql = R"(
+            INSERT INTO NameTable (NameID, OwnerID, Surname, Given, Prefix, Suffix, Nickname,
+                                   NameType, IsPrimary, BirthYear, DeathYear, UTCModDate)
+            VALUES (?, ?, ?, ?, '', '', '', ?, ?, ?, ?, ?)
+        )";
+        CachedStatement stmt(m_statements, insertNameSql);
+        if (!stmt) return false;
+        sqlite3_bind_int(stmt, 1, m_nextNameId++);
+        sqlite3_bind_int(stmt, 2, ownerId);
+        bindText(stmt, 3, surname);
+        bindText(stmt, 4, given);
+        sqlite3_bind_int(stmt, 5, nameType);
+        sqlite3_bind_int(stmt, 6, primary ? 1 : 0);
+        sqlite3_bind_int(stmt, 7, birthYear);
+        sqlite3_bind_int(stmt, 8, deathYear);
+        sqlite3_bind_double(stmt, 9, m_options.modificationDate);
+        return step(m_db, stmt);
+    }
+
+    bool addChild(int ownerId, int familyId, int childOrder)
+    {
+        const char* insertChildSql = "INSERT INTO ChildTable (ChildID, FamilyID, RelFather, RelMother, ChildOrder, UTCModDate) VALUES (?, ?, 0, 0, ?, ?)";
+        CachedStatement stmt(m_statements, insertChildSql);
+        if (!stmt) return false;
+        sqlite3_bind_int(stmt, 1, ownerId);
+        sqlite3_bind_int(stmt, 2, familyId);
+        sqlite3_bind_int(stmt, 3, childOrder);
+        sqlite3_bind_double(stmt, 4, m_options.modificationDate);
+        return step(m_db, stmt);
+    }
+
+    bool addFamily(int familyId, int fatherId, int motherId, int firstChildId)
+    {
+        const char* insertFamilySql = "INSERT INTO FamilyTable (FamilyID, FatherID, MotherID, ChildID, HusbOrder, WifeOrder, UTCModDate) VALUES (?, ?, ?, ?, 0, 0, ?)";
+        {
+            CachedStatement stmt(m_statements, insertFamilySql);
+            if (!stmt) return false;
+            sqlite3_bind_int(stmt, 1, familyId);
+            sqlite3_bind_int(stmt, 2, fatherId);
+            sqlite3_bind_int(stmt, 3, motherId);
+            sqlite3_bind_int(stmt, 4, firstChildId);
+            sqlite3_bind_double(stmt, 5, m_options.modificationDate);
+            if (!step(m_db, stmt)) return false;
+        }
+
+        const char* spouseSql = "UPDATE PersonTable SET SpouseID = ? WHERE PersonID IN (?, ?)";
+        CachedStatement stmt(m_statements, spouseSql);
+        if (!stmt) return false;
+        sqlite3_bind_int(stmt, 1, familyId);
+        sqlite3_bind_int(stmt, 2, fatherId);
+        sqlite3_bind_int(stmt, 3, motherId);
+        return step(m_db, stmt);
+    }
+
+    sqlite3* m_db;
+    StatementCache m_statements;
+    const SyntheticTreeOptions& m_options;
+    std::mt19937 m_random;
+    std::discrete_distribution<int> m_surnames;
+    std::vector<Adult> m_men;
+    std::vector<Adult> m_women;
+    int m_nextOwnerId;
+    int m_nextNameId;
+    int m_nextFamilyId;
+};
+
+int insertTag(sqlite3* db, StatementCache& statements, int parentId, const std::string& name)
+{
+    const char* insertTagSql = "INSERT INTO Tags (pid, name, icon, iconkde) VALUES (?, ?, NULL, ?)";
+    CachedStatement stmt(statements, insertTagSql);
+    if (!stmt) return 0;
+    sqlite3_bind_int(stmt, 1, parentId);
+    sqlite3_bind_text(stmt, 2, name.data(), static_cast<int>(name.size()), SQLITE_STATIC);
+    if (parentId != 0) {
+        bindText(stmt, 3, "user");
+    }
+    if (!step(db, stmt)) return 0;
+    return static_cast<int>(sqlite3_last_insert_rowid(db));
+}
+
+bool insertProperty(sqlite3* db, StatementCache& statements, int tagId, const char* property, const std::string& value)
+{
+    const char* insertPropertySql = "INSERT INTO TagProperties (tagid, property, value) VALUES (?, ?, ?)";
+    CachedStatement stmt(statements, insertPropertySql);
+    if (!stmt) return false;
+    sqlite3_bind_int(stmt, 1, tagId);
+    bindText(stmt, 2, property);
+    sqlite3_bind_text(stmt, 3, value.data(), static_cast<int>(value.size()), SQLITE_STATIC);
+    return step(db, stmt);
+}
+
+bool insertPersonTag(sqlite3* db, StatementCache& statements, int parentId, int ownerId, const std::string& name)
+{
+    int tagId = insertTag(db, statements, parentId, name);
+    return tagId != 0 &&
+           insertProperty(db, statements, tagId, "rootsmagic_owner_id", std::to_string(ownerId)) &&
+           insertProperty(db, statements, tagId, "person", name);
+}
+
+}
+
+bool generateRootsMagicDatabase(const std::string& path, const SyntheticTreeOptions& options)
+{
+    sqlite3* db = createDatabase(path);
+    if (!db) {
+        return false;
+    }
+
+    // The columns and indexes the sync reads, as RootsMagic 8 declares them
+    const char* schemaSql = R"(
+        CREATE TABLE PersonTable (PersonID INTEGER PRIMARY KEY, UniqueID TEXT, Sex INTEGER, ParentID INTEGER,
+                                  SpouseID INTEGER, Color INTEGER, Living INTEGER, IsPrivate INTEGER,
+                                  UTCModDate FLOAT);
+        CREATE TABLE NameTable (NameID INTEGER PRIMARY KEY, OwnerID INTEGER, Surname TEXT COLLATE RMNOCASE,
+                                Given TEXT COLLATE RMNOCASE, Prefix TEXT COLLATE RMNOCASE,
+                                Suffix TEXT COLLATE RMNOCASE, Nickname TEXT COLLATE RMNOCASE,
+                                NameType INTEGER, IsPrimary INTEGER, BirthYear INTEGER, DeathYear INTEGER,
+                                UTCModDate FLOAT);
+        CREATE TABLE FamilyTable (FamilyID INTEGER PRIMARY KEY, FatherID INTEGER, MotherID INTEGER,
+                                  ChildID INTEGER, HusbOrder INTEGER, WifeOrder INTEGER, IsPrivate INTEGER,
+                                  UTCModDate FLOAT);
+        CREATE TABLE ChildTable (RecID INTEGER PRIMARY KEY, ChildID INTEGER, FamilyID INTEGER,
+                                 RelFather INTEGER, RelMother INTEGER, ChildOrder INTEGER, IsPrivate INTEGER,
+                                 UTCModDate FLOAT);
+    )";
+    const char* indexSql = R"(
+        CREATE INDEX idxNameOwnerID ON NameTable (OwnerID);
+        CREATE INDEX idxSurnameGiven ON NameTable (Surname, Given, BirthYear, DeathYear);
+        CREATE INDEX idxFamilyFatherID ON FamilyTable (FatherID);
+        CREATE INDEX idxFamilyMotherID ON FamilyTable (MotherID);
+        CREATE INDEX idxChildID ON ChildTable (ChildID);
+        CREATE INDEX idxChildFamilyID ON ChildTable (FamilyID);
+    )";
+
+    bool success = registerRmnocaseCollation(db) == SQLITE_OK &&
+                   execute(db, schemaSql) &&
+                   execute(db, "BEGIN TRANSACTION;");
+    if (success) {
+        TreeWriter writer(db, options);
+        success = writer.write();
+    }
+    // Indexes are built once at the end, which is much faster than maintaining them per row
+    success = success && execute(db, "COMMIT;") && execute(db, indexSql) && execute(db, "ANALYZE;");
+
+    sqlite3_close(db);
+    return success;
+}
+
+bool generateDigiKamDatabase(const std::string& path, const std::string& rootsMagicPath,
+                             const SyntheticTagOptions& options)
+{
+    sqlite3* rootsMagicDb = nullptr;
+    if (sqlite3_open_v2(rootsMagicPath.c_str(), &rootsMagicDb, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "Failed to open " << rootsMagicPath << ": " << sqlite3_errmsg(rootsMagicDb) << std::endl;
+        sqlite3_close(rootsMagicDb);
+        return false;
+    }
+    registerRmnocaseCollation(rootsMagicDb);
+
+    sqlite3* db = createDatabase(path);
+    if (!db) {
+        sqlite3_close(rootsMagicDb);
+        return false;
+    }
+
+    // DigiKam 7's tag tables and the triggers that keep TagsTree current
+    const char* schemaSql = R"(
+        CREATE TABLE Tags (id INTEGER PRIMARY KEY, pid INTEGER, name TEXT NOT NULL, icon INTEGER,
+                           iconkde TEXT, UNIQUE (name, pid));
+        CREATE TABLE TagsTree (id INTEGER NOT NULL, pid INTEGER NOT NULL, UNIQUE (id, pid));
+        CREATE TABLE TagProperties (tagid INTEGER, property TEXT, value TEXT);
+        CREATE INDEX tagproperties_index ON TagProperties (tagid);
+        CREATE TABLE ImageTags (imageid INTEGER NOT NULL, tagid INTEGER NOT NULL, UNIQUE (imageid, tagid));
+        CREATE INDEX tag_index ON ImageTags (tagid);
+        CREATE TRIGGER insert_tagstree AFTER INSERT ON Tags
+        BEGIN
+            INSERT INTO TagsTree SELECT new.id, new.pid
+            UNION SELECT new.id, pid FROM TagsTree WHERE id = new.pid;
+        END;
+        CREATE TRIGGER delete_tagstree DELETE ON Tags
+        BEGIN
+            DELETE FROM Tags WHERE id IN (SELECT id FROM TagsTree WHERE pid = OLD.id);
+            DELETE FROM TagsTree WHERE id IN (SELECT id FROM TagsTree WHERE pid = OLD.id);
+            DELETE FROM TagsTree WHERE id = OLD.id;
+            DELETE FROM ImageTags WHERE tagid = OLD.id;
+        END;
+        CREATE TRIGGER move_tagstree UPDATE OF pid ON Tags
+        BEGIN
+            DELETE FROM TagsTree
+                WHERE ((id = OLD.id) OR id IN (SELECT id FROM TagsTree WHERE pid = OLD.id))
+                AND pid IN (SELECT pid FROM TagsTree WHERE id = OLD.id);
+            INSERT INTO TagsTree SELECT NEW.id, NEW.pid
+                UNION SELECT NEW.id, pid FROM TagsTree WHERE id = NEW.pid
+                UNION SELECT id, NEW.pid FROM TagsTree WHERE pid = NEW.id
+                UNION SELECT A.id, B.pid FROM TagsTree A, TagsTree B WHERE A.pid = NEW.id AND B.id = NEW.pid;
+        END;
+    )";
+
+    bool success = execute(db, schemaSql) && execute(db, "BEGIN TRANSACTION;");
+    {
+        StatementCache statements(db);
+        StatementCache rootsMagicStatements(rootsMagicDb);
+
+        // Tags a real collection would have next to the RootsMagic ones
+        int internalId = success ? insertTag(db, statements, 0, "_Digikam_Internal_Tags_") : 0;
+        int placesId = success ? insertTag(db, statements, 0, "Places") : 0;
+        success = internalId && placesId &&
+                  insertTag(db, statements, internalId, "Color Label None") &&
+                  insertTag(db, statements, placesId, "Paris") &&
+                  insertTag(db, statements, placesId, "Stockholm");
+
+        bool wantsTags = options.taggedFraction > 0 || options.lostFoundFraction > 0 || options.orphanTags > 0;
+        int parentId = 0;
+        int lostFoundId = 0;
+        if (success && wantsTags) {
+            parentId = insertTag(db, statements, 0, options.parentTagName);
+            lostFoundId = insertTag(db, statements, 0, options.lostFoundTagName);
+            success = parentId && lostFoundId;
+        }
+
+        NameFormat format;
+        std::string error;
+        format.parsePerson(NameFormat::kDefaultPersonFormat, error);
+
+        std::mt19937 random(options.seed);
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        int maxOwnerId = 0;
+        std::string name;
+
+        const char* peopleSql = "SELECT OwnerID, Surname, Given, BirthYear, DeathYear FROM NameTable WHERE IsPrimary = 1 ORDER BY OwnerID";
+        CachedStatement stmt(rootsMagicStatements, peopleSql);
+        if (success && wantsTags && !stmt) {
+            std::cerr << "Failed to read people from " << rootsMagicPath << ": " << sqlite3_errmsg(rootsMagicDb) << std::endl;
+            success = false;
+        }
+        while (success && wantsTags && sqlite3_step(stmt) == SQLITE_ROW) {
+            PersonRecord person = {};
+            person.ownerId = sqlite3_column_int(stmt, 0);
+            person.surname = columnView(stmt, 1);
+            person.given = columnView(stmt, 2);
+            person.birthYear = sqlite3_column_int(stmt, 3);
+            person.deathYear = sqlite3_column_int(stmt, 4);
+            maxOwnerId = std::max(maxOwnerId, person.ownerId);
+
+            double roll = chance(random);
+            if (roll >= options.taggedFraction + options.lostFoundFraction) {
+                continue;
+            }
+
+            name.clear();
+            format.render(person, name);
+            if (chance(random) < options.staleNameFraction) {
+                name.insert(0, "Old ");
+            }
+            int tagParent = roll < options.taggedFraction ? parentId : lostFoundId;
+            success = insertPersonTag(db, statements, tagParent, person.ownerId, name);
+        }
+
+        // Tags whose people have since been deleted from RootsMagic
+        for (size_t i = 0; success && i < options.orphanTags; i++) {
+            int ownerId = maxOwnerId + 1 + static_cast<int>(i);
+            success = insertPersonTag(db, statements, parentId, ownerId,
+                                      "Deleted Person (OwnerID: " + std::to_string(ownerId) + ")");
+        }
+    }
+    success = success && execute(db, "COMMIT;");
+
+    sqlite3_close(db);
+    sqlite3_close(rootsMagicDb);
+    return success;
+}
@@ -0,0 +1,291 @@
+#include "tagindex.h"
+#include "logger.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+const std::vector<int> kNoTags;
+}
+
+const char* const TagIndex::kLookupIndexName = "tagproperties_rootsmagic_index";
+
+// The index expression and WHERE clause have to match these queries exactly for
+// the planner to use it; an IN list would not count as implying the index's OR
+const char* const TagIndex::kPropertiesSql = R"(
+    SELECT tagid, property, CAST(value AS INTEGER) FROM TagProperties
+    WHERE property = 'rootsmagic_owner_id' OR property = 'family_id'
+)";
+
+TagIndex::TagIndex()
+    : m_loaded(false)
+{
+}
+
+bool TagIndex::load(sqlite3* db, StatementCache& statements)
+{
+    clear();
+
+    const char* tagsSql = "SELECT id, pid, name FROM Tags";
+    {
+        CachedStatement stmt(statements, tagsSql);
+        if (!stmt) {
+            logError() << "Failed to load DigiKam Tags: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const unsigned char* name = sqlite3_column_text(stmt, 2);
+            addTag(sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1),
+                   name ? reinterpret_cast<const char*>(name) : "");
+        }
+    }
+
+    {
+        CachedStatement stmt(statements, kPropertiesSql);
+        if (!stmt) {
+            logError() << "Failed to load DigiKam TagProperties: " << sqlite3_errmsg(db) << std::endl;
+            clear();
+            return false;
+        }
+
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            int tagId = sqlite3_column_int(stmt, 0);
+            std::string property = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            int value = sqlite3_column_int(stmt, 2);
+            if (property == "rootsmagic_owner_id") {
+                setOwnerId(tagId, value);
+            } else {
+                setFamilyId(tagId, value);
+            }
+        }
+    }
+
+    m_loaded = true;
+    return true;
+}
+
+bool TagIndex::createLookupIndex(sqlite3* db)
+{
+    std::string sql = std::string("CREATE INDEX IF NOT EXISTS ") + kLookupIndexName +
+                      " ON TagProperties (property, CAST(value AS INTEGER), tagid)"
+                      " WHERE property = 'rootsmagic_owner_id' OR property = 'family_id'";
+    char* errorMessage = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errorMessage) != SQLITE_OK) {
+        logWarning() << "Warning: Failed to create " << kLookupIndexName << ": "
+                     << (errorMessage ? errorMessage : "unknown error") << std::endl;
+        sqlite3_free(errorMessage);
+        return false;
+    }
+    return true;
+}
+
+bool TagIndex::lookupIndexUsed(sqlite3* db, const std::string& sql)
+{
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, ("EXPLAIN QUERY PLAN " + sql).c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return false;
+    }
+
+    // Detail rows read like "SEARCH TagProperties USING INDEX <name> (property=?)", with
+    // the table's alias if the query gives it one, and COVERING INDEX on newer SQLite
+    const std::string indexDetail = std::string(" INDEX ") + kLookupIndexName + " ";
+    bool searches = false;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* column = sqlite3_column_text(stmt, 3);
+        std::string_view detail = column ? reinterpret_cast<const char*>(column) : "";
+        if (detail.substr(0, 7) == "SEARCH " && detail.find(indexDetail) != std::string_view::npos) {
+            searches = true;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return searches;
+}
+
+void TagIndex::clear()
+{
+    m_tags.clear();
+    m_children.clear();
+    m_byOwner.clear();
+    m_byFamily.clear();
+    m_loaded = false;
+}
+
+const TagIndexEntry* TagIndex::findById(int tagId) const
+{
+    auto it = m_tags.find(tagId);
+    return it != m_tags.end() ? &it->second : nullptr;
+}
+
+int TagIndex::findChild(int pid, std::string_view name) const
+{
+    auto parentIt = m_children.find(pid);
+    if (parentIt == m_children.end()) return 0;
+
+    auto it = parentIt->second.find(name);
+    return it != parentIt->second.end() ? it->second : 0;
+}
+
+int TagIndex::findByName(std::string_view name) const
+{
+    // Top-level tags are the common case (parent and Lost & Found tags)
+    if (int tagId = findChild(0, name)) {
+        return tagId;
+    }
+
+    // Otherwise take the first match in id order, as a table scan would
+    int found = 0;
+    for (const auto& [tagId, entry] : m_tags) {
+        if (entry.name == name && (found == 0 || tagId < found)) {
+            found = tagId;
+        }
+    }
+    return found;
+}
+
+int TagIndex::findOwnerTag(int ownerId, int pid) const
+{
+    for (int tagId : tagsForOwner(ownerId)) {
+        if (m_tags.at(tagId).pid == pid) {
+            return tagId;
+        }
+    }
+    return 0;
+}
+
+const std::vector<int>& TagIndex::tagsForOwner(int ownerId) const
+{
+    auto it = m_byOwner.find(ownerId);
+    return it != m_byOwner.end() ? it->second : kNoTags;
+}
+
+const std::vector<int>& TagIndex::tagsForFamily(int familyId) const
+{
+    auto it = m_byFamily.find(familyId);
+    return it != m_byFamily.end() ? it->second : kNoTags;
+}
+
+std::vector<int> TagIndex::childrenOf(int tagId) const
+{
+    std::vector<int> childIds;
+    auto childrenIt = m_children.find(tagId);
+    if (childrenIt != m_children.end()) {
+        childIds.reserve(childrenIt->second.size());
+        for (const auto& [name, childId] : childrenIt->second) {
+            childIds.push_back(childId);
+        }
+    }
+    return childIds;
+}
+
+size_t TagIndex::countOwnersUnder(int tagId) const
+{
+    std::unordered_set<int> owners;
+    forEachDescendant(tagId, [&](const TagIndexEntry& entry) {
+        if (entry.ownerId != 0) {
+            owners.insert(entry.ownerId);
+        }
+    });
+    return owners.size();
+}
+
+void TagIndex::addTag(int tagId, int pid, std::string_view name)
+{
+    auto it = m_tags.find(tagId);
+    if (it != m_tags.end()) {
+        unlinkFromParent(it->second);
+        it->second = TagIndexEntry{tagId, pid, std::string(name), 0, 0};
+    } else {
+        it = m_tags.emplace(tagId, TagIndexEntry{tagId, pid, std::string(name), 0, 0}).first;
+    }
+    linkToParent(it->second);
+}
+
+void TagIndex::renameTag(int tagId, std::string_view name)
+{
+    auto it = m_tags.find(tagId);
+    if (it == m_tags.end()) return;
+
+    unlinkFromParent(it->second);
+    it->second.name = std::string(name);
+    linkToParent(it->second);
+}
+
+void TagIndex::moveTag(int tagId, int newPid)
+{
+    auto it = m_tags.find(tagId);
+    if (it == m_tags.end()) return;
+
+    unlinkFromParent(it->second);
+    it->second.pid = newPid;
+    linkToParent(it->second);
+}
+
+void TagIndex::removeTag(int tagId)
+{
+    auto it = m_tags.find(tagId);
+    if (it == m_tags.end()) return;
+
+    // DigiKam's delete trigger removes the whole subtree, so the index does too
+    for (int childId : childrenOf(tagId)) {
+        removeTag(childId);
+    }
+    m_children.erase(tagId);
+
+    const TagIndexEntry& entry = it->second;
+    unlinkFromParent(entry);
+    if (entry.ownerId) eraseId(m_byOwner, entry.ownerId, tagId);
+    if (entry.familyId) eraseId(m_byFamily, entry.familyId, tagId);
+    m_tags.erase(it);
+}
+
+void TagIndex::setOwnerId(int tagId, int ownerId)
+{
+    auto it = m_tags.find(tagId);
+    if (it == m_tags.end()) return;
+
+    if (it->second.ownerId) eraseId(m_byOwner, it->second.ownerId, tagId);
+    it->second.ownerId = ownerId;
+    m_byOwner[ownerId].push_back(tagId);
+}
+
+void TagIndex::setFamilyId(int tagId, int familyId)
+{
+    auto it = m_tags.find(tagId);
+    if (it == m_tags.end()) return;
+
+    if (it->second.familyId) eraseId(m_byFamily, it->second.familyId, tagId);
+    it->second.familyId = familyId;
+    m_byFamily[familyId].push_back(tagId);
+}
+
+void TagIndex::linkToParent(const TagIndexEntry& entry)
+{
+    // Replaces the key too, so it views this entry's name rather than a previous holder's
+    auto& children = m_children[entry.pid];
+    children.erase(entry.name);
+    children.emplace(entry.name, entry.id);
+}
+
+void TagIndex::unlinkFromParent(const TagIndexEntry& entry)
+{
+    auto parentIt = m_children.find(entry.pid);
+    if (parentIt == m_children.end()) return;
+
+    auto it = parentIt->second.find(entry.name);
+    if (it != parentIt->second.end() && it->second == entry.id) {
+        parentIt->second.erase(it);
+    }
+}
+
+void TagIndex::eraseId(std::unordered_map<int, std::vector<int>>& map, int key, int tagId)
+{
+    auto it = map.find(key);
+    if (it == map.end()) return;
+
+    auto& ids = it->second;
+    ids.erase(std::remove(ids.begin(), ids.end(), tagId), ids.end());
+    if (ids.empty()) {
+        map.erase(it);
+    }
+}
@@ -0,0 +1,173 @@
+// Incremental sync and its sync mark: a generated tree is synced once in full,
+// then changed, and each change is synced with and without -i into two copies
+// of the same DigiKam database. Both copies must end up with the same tags.
+#include "rootsmagicsync.h"
+#include "syntheticdb.h"
+#include "testsupport.h"
+#include <filesystem>
+
+namespace {
+
+const char* const kRootsMagicPath = "incremental_test.rmtree";
+const char* const kFullPath = "incremental_test_full.db";
+const char* const kIncrementalPath = "incremental_test_incremental.db";
+
+const char* const kMarkSql = R"(
+    SELECT tp.value FROM TagProperties tp JOIN Tags t ON t.id = tp.tagid
+    WHERE t.pid = 0 AND t.name = 'RootsMagic' AND tp.property = 'rootsmagic_sync_mark'
+)";
+
+SyncReport runSync(const std::string& digiKamPath, bool incremental)
+{
+    RootsMagicSync sync;
+    sync.setIncremental(incremental);
+    if (!sync.connectToRootsMagicDatabase(kRootsMagicPath) || !sync.connectToDigiKamDatabase(digiKamPath)) {
+        return SyncReport();
+    }
+    return sync.synchronize();
+}
+
+// Every tag by its path, with its properties, so two databases compare whatever their tag ids
+std::string tagsState(const std::string& path)
+{
+    const char* sql = R"(
+        WITH RECURSIVE paths(id, path) AS (
+            SELECT id, name FROM Tags WHERE pid = 0
+            UNION ALL
+            SELECT t.id, p.path || '/' || t.name FROM Tags t JOIN paths p ON t.pid = p.id
+        )
+        SELECT p.path, (SELECT group_concat(property || '=' || value, ';')
+                        FROM (SELECT property, value FROM TagProperties WHERE tagid = p.id ORDER BY property, value))
+        FROM paths p ORDER BY 1, 2
+    )";
+
+    sqlite3* db = nullptr;
+    std::string state;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                const unsigned char* properties = sqlite3_column_text(stmt, 1);
+                state += reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+                state += " ";
+                state += properties ? reinterpret_cast<const char*>(properties) : "";
+                state += "\n";
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return state;
+}
+
+// Syncs the current RootsMagic file into both copies, in full and incrementally
+void syncBoth(SyncReport& full, SyncReport& incremental)
+{
+    full = runSync(kFullPath, false);
+    incremental = runSync(kIncrementalPath, true);
+    CHECK(full.success);
+    CHECK(incremental.success);
+    CHECK(!tagsState(kFullPath).empty());
+    CHECK(tagsState(kFullPath) == tagsState(kIncrementalPath));
+}
+
+}
+
+int main()
+{
+    // Quiet unless something goes wrong
+    RootsMagicSync::setLogCallback([](LogLevel level, std::string_view line) {
+        if (level <= LogLevel::Warning) {
+            std::cerr << line << "\n";
+        }
+    });
+
+    SyntheticTreeOptions tree;
+    tree.people = 3000;
+    SyntheticTagOptions tags;
+    tags.taggedFraction = 0.6;
+    tags.lostFoundFraction = 0.2;
+    tags.staleNameFraction = 0.1;
+    tags.orphanTags = 20;
+    if (!generateRootsMagicDatabase(kRootsMagicPath, tree) ||
+        !generateDigiKamDatabase(kFullPath, kRootsMagicPath, tags)) {
+        std::cerr << "Failed to generate the test databases\n";
+        return 1;
+    }
+    std::filesystem::copy_file(kFullPath, kIncrementalPath, std::filesystem::copy_options::overwrite_existing);
+
+    // Without a mark an incremental run falls back to a full sync, and records the newest modification date
+    CHECK(queryText(kIncrementalPath, kMarkSql).empty());
+    SyncReport first = runSync(kIncrementalPath, true);
+    CHECK(first.success);
+    CHECK(first.mode == "full");
+    CHECK(std::stod(queryText(kIncrementalPath, kMarkSql)) == tree.modificationDate);
+
+    // One full sync settles the tree: rescued tags land under their family tag straight away
+    std::string firstState = tagsState(kIncrementalPath);
+    SyncReport full = runSync(kFullPath, false);
+    CHECK(full.success);
+    CHECK(full.tagsRescued > 0);
+    CHECK(tagsState(kFullPath) == firstState);
+    CHECK(runSync(kFullPath, false).rowsWritten == 0);
+
+    // Nothing changed, so an incremental run loads no one and writes nothing
+    SyncReport incremental = runSync(kIncrementalPath, true);
+    CHECK(incremental.mode == "incremental");
+    CHECK(incremental.people == 0);
+    CHECK(incremental.rowsWritten == 0);
+    CHECK(tagsState(kIncrementalPath) == firstState);
+
+    // Tags an older version left directly under the parent tag move into their family tag incrementally too
+    const char* flattenSql = R"(
+        UPDATE Tags SET pid = (SELECT id FROM Tags WHERE pid = 0 AND name = 'RootsMagic')
+        WHERE id IN (SELECT tagid FROM TagProperties WHERE property = 'rootsmagic_owner_id')
+        AND pid IN (SELECT tagid FROM TagProperties WHERE property = 'family_id')
+        AND id % 3 = 0
+    )";
+    CHECK(executeSql(kIncrementalPath, flattenSql));
+    CHECK(tagsState(kIncrementalPath) != firstState);
+    incremental = runSync(kIncrementalPath, true);
+    CHECK(incremental.mode == "incremental");
+    CHECK(tagsState(kIncrementalPath) == firstState);
+
+    // Renames and deletions are picked up by date, and the mark moves to the newest one
+    CHECK(executeSql(kRootsMagicPath, R"(
+        UPDATE NameTable SET Given = 'Renamed', UTCModDate = 2460100 WHERE OwnerID IN (4, 10, 11, 500) AND IsPrimary = 1;
+        DELETE FROM NameTable WHERE OwnerID IN (7, 20, 33, 1200);
+    )"));
+    syncBoth(full, incremental);
+    CHECK(incremental.mode == "incremental");
+    CHECK(incremental.tagsUpdated == 4);
+    CHECK(incremental.tagsOrphaned == full.tagsOrphaned);
+    CHECK(incremental.tagsOrphaned == 4);
+    // One row per moved tag, not the TagsTree rows DigiKam's triggers rewrite with it
+    CHECK(incremental.phases[static_cast<size_t>(SyncPhase::OrphanMove)].rows == 4);
+    CHECK(std::stod(queryText(kIncrementalPath, kMarkSql)) == 2460100.0);
+
+    // A deleted person coming back is rescued from Lost & Found
+    CHECK(executeSql(kRootsMagicPath, R"(
+        INSERT INTO NameTable (OwnerID, Surname, Given, BirthYear, DeathYear, IsPrimary, UTCModDate)
+        VALUES (20, 'Back', 'Again', 1900, 0, 1, 2460200);
+    )"));
+    syncBoth(full, incremental);
+    CHECK(incremental.mode == "incremental");
+    CHECK(incremental.tagsRescued == 1);
+
+    // A mark ahead of the RootsMagic file, e.g. after restoring an older copy of it, forces a full sync
+    CHECK(executeSql(kIncrementalPath, R"(
+        UPDATE TagProperties SET value = '2460900' WHERE property = 'rootsmagic_sync_mark'
+    )"));
+    CHECK(executeSql(kRootsMagicPath, R"(
+        UPDATE NameTable SET Surname = 'Restored', UTCModDate = 2460300 WHERE OwnerID = 1 AND IsPrimary = 1;
+    )"));
+    syncBoth(full, incremental);
+    CHECK(incremental.mode == "full");
+    CHECK(incremental.tagsUpdated == full.tagsUpdated);
+    CHECK(std::stod(queryText(kIncrementalPath, kMarkSql)) == 2460300.0);
+
+    for (const char* path : {kRootsMagicPath, kFullPath, kIncrementalPath}) {
+        std::filesystem::remove(path);
+    }
+    return testFailures();
+}
@@ -0,0 +1,57 @@
+// TagIndex::createLookupIndex: the queries it is built for must search it,
+// on a generated DigiKam database and again once it has been analyzed.
+#include "syntheticdb.h"
+#include "tagindex.h"
+#include "testsupport.h"
+#include <filesystem>
+
+namespace {
+
+const char* const kRootsMagicPath = "lookup_index_test.rmtree";
+const char* const kDigiKamPath = "lookup_index_test.db";
+
+// Owner tags joined to their property under an alias, as the streaming snapshot reads them
+const char* const kOwnerTagsSql = R"(
+    SELECT t.id, t.pid, t.name, CAST(tp.value AS INTEGER) FROM Tags t
+    JOIN TagProperties tp ON t.id = tp.tagid
+    WHERE tp.property = 'rootsmagic_owner_id'
+)";
+
+}
+
+int main()
+{
+    SyntheticTreeOptions tree;
+    tree.people = 2000;
+    SyntheticTagOptions tags;
+    tags.taggedFraction = 0.8;
+    tags.lostFoundFraction = 0.1;
+    if (!generateRootsMagicDatabase(kRootsMagicPath, tree) ||
+        !generateDigiKamDatabase(kDigiKamPath, kRootsMagicPath, tags)) {
+        std::cerr << "Failed to generate the test databases\n";
+        return 1;
+    }
+
+    sqlite3* db = nullptr;
+    CHECK(sqlite3_open(kDigiKamPath, &db) == SQLITE_OK);
+
+    CHECK(!TagIndex::lookupIndexUsed(db, TagIndex::kPropertiesSql));
+    CHECK(!TagIndex::lookupIndexUsed(db, kOwnerTagsSql));
+    CHECK(TagIndex::createLookupIndex(db));
+    CHECK(TagIndex::lookupIndexUsed(db, TagIndex::kPropertiesSql));
+    CHECK(TagIndex::lookupIndexUsed(db, kOwnerTagsSql));
+
+    // Creating it again is a no-op
+    CHECK(TagIndex::createLookupIndex(db));
+
+    // Statistics from ANALYZE must not talk the planner out of the index
+    CHECK(sqlite3_exec(db, "ANALYZE;", nullptr, nullptr, nullptr) == SQLITE_OK);
+    CHECK(TagIndex::lookupIndexUsed(db, TagIndex::kPropertiesSql));
+    CHECK(TagIndex::lookupIndexUsed(db, kOwnerTagsSql));
+
+    sqlite3_close(db);
+    for (const char* path : {kRootsMagicPath, kDigiKamPath}) {
+        std::filesystem::remove(path);
+    }
+    return testFailures();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// Small helpers shared by the test programs. Each test is a plain executable
+// run by CTest in its own build directory; it prints every failed check and
+// returns the number of failures from main.
+#include "rmnocase.h"
+#include "sqlite3.h"
+#include <iostream>
+#include <string>
+
+inline int& testFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                      \
+    do {                                                                                      \
+        if (!(condition)) {                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << "\n"; \
+            testFailures()++;                                                                 \
+        }                                                                                     \
+    } while (false)
+
+// Runs sql against the database at path; RootsMagic files need their collation to be written
+inline bool executeSql(const std::string& path, const std::string& sql)
+{
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "Failed to open " << path << ": " << sqlite3_errmsg(db) << "\n";
+        sqlite3_close(db);
+        return false;
+    }
+
+    registerRmnocaseCollation(db);
+    char* errorMessage = nullptr;
+    bool success = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errorMessage) == SQLITE_OK;
+    if (!success) {
+        std::cerr << "Failed to run SQL on " << path << ": " << (errorMessage ? errorMessage : "unknown") << "\n";
+        sqlite3_free(errorMessage);
+    }
+    sqlite3_close(db);
+    return success;
+}
+
+// First column of the first row as text, or "" when there is none
+inline std::string queryText(const std::string& path, const std::string& sql)
+{
+    sqlite3* db = nullptr;
+    std::string value;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0)) {
+            value = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return value;
+}